@@ -0,0 +1,295 @@
+//hashes.c - Throughput and quality battery for the hashers in hashes.h
+//Usage: hashes [keys per quality set]
+//Exits with 1 when any hasher other than the identity/legacy_x41 reference points rates POOR
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#include "hashes.h"
+
+#define BUCKET_BITS 12
+#define AVALANCHE_SAMPLES 2000
+
+typedef struct
+{
+	const char *name;
+	size_t (*hasher)(void *);
+	//Shown for comparison only, a POOR rating is expected and does not fail the run
+	int reference;
+} hasher_t;
+
+typedef struct
+{
+	const char *name;
+	void **keys;
+	size_t count;
+} keyset_t;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t cycles(void)
+{
+#ifdef HAVE_RDTSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+//hash_str before hash_mem replaced it, kept as a reference point
+static size_t legacy_str(void *ptr)
+{
+	char *str = ptr;
+	size_t hash = *str;
+
+	while (*str && *(++str)) hash = hash * 41 + *str;
+
+	return hash;
+}
+
+static size_t identity(void *ptr)
+{
+	return (size_t)ptr;
+}
+
+static void bench_throughput(void)
+{
+	static const size_t sizes[] = { 4, 8, 16, 32, 64, 128, 256, 512, 1024, 4096 };
+	char *buf = malloc(4096 + 64);
+
+	for (size_t i = 0; i < 4096 + 64; i++)
+		buf[i] = 'a' + rng_next() % 26;
+
+	printf("%-10s %8s %10s %12s %10s %12s\n", "size", "", "hash_mem", "", "hash_str", "");
+	printf("%-10s %8s %10s %12s %10s %12s\n", "bytes", "", "GB/s", "cycles/hash", "GB/s", "cycles/hash");
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+		size_t len = sizes[s];
+		size_t iters = (256u << 20) / len;
+		volatile size_t sink = 0;
+		size_t acc = 0;
+
+		double start = now();
+		uint64_t c0 = cycles();
+		for (size_t i = 0; i < iters; i++)
+			acc += hash_mem(buf + (i & 63), len);
+		uint64_t mem_cycles = cycles() - c0;
+		double mem_time = now() - start;
+
+		char saved = buf[len];
+		buf[len] = '\0';
+		start = now();
+		c0 = cycles();
+		for (size_t i = 0; i < iters; i++)
+			acc += hash_str(buf);
+		uint64_t str_cycles = cycles() - c0;
+		double str_time = now() - start;
+		buf[len] = saved;
+
+		sink = acc;
+		(void)sink;
+
+		printf("%-10zu %8s %10.2f %12.1f %10.2f %12.1f\n", len, "",
+			(double)len * iters / mem_time * 1e-9, (double)mem_cycles / iters,
+			(double)len * iters / str_time * 1e-9, (double)str_cycles / iters);
+	}
+
+#ifndef HAVE_RDTSC
+	printf("(no cycle counter on this target, cycle columns are 0)\n");
+#endif
+	printf("\n");
+	free(buf);
+}
+
+static int compare_u64_values(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return x == y ? 0 : (x > y ? 1 : -1);
+}
+
+static size_t count_collisions(uint64_t *hashes, size_t count, uint64_t mask)
+{
+	for (size_t i = 0; i < count; i++)
+		hashes[i] &= mask;
+
+	qsort(hashes, count, sizeof(uint64_t), compare_u64_values);
+
+	size_t collisions = 0;
+	for (size_t i = 1; i < count; i++)
+		collisions += hashes[i] == hashes[i - 1];
+
+	return collisions;
+}
+
+//Chi-squared over 2^BUCKET_BITS buckets as a z-score, |z| above ~4 means the buckets are not uniform
+static double bucket_z(const uint64_t *hashes, size_t count, int high_bits)
+{
+	size_t buckets = (size_t)1 << BUCKET_BITS;
+	size_t *observed = calloc(buckets, sizeof(size_t));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t h = hashes[i];
+		if (high_bits && sizeof(size_t) == 8)
+			observed[h >> (64 - BUCKET_BITS)]++;
+		else if (high_bits)
+			observed[(uint32_t)h >> (32 - BUCKET_BITS)]++;
+		else
+			observed[h & (buckets - 1)]++;
+	}
+
+	double expected = (double)count / buckets, chi = 0;
+	for (size_t i = 0; i < buckets; i++)
+		chi += (observed[i] - expected) * (observed[i] - expected) / expected;
+
+	free(observed);
+
+	double df = buckets - 1;
+	return (chi - df) / sqrt(2 * df);
+}
+
+//Returns non-zero when the hasher rates POOR on the set and is not a reference point
+static int quality_row(const hasher_t *hasher, const keyset_t *set)
+{
+	uint64_t *hashes = malloc(set->count * sizeof(uint64_t));
+
+	for (size_t i = 0; i < set->count; i++)
+		hashes[i] = hasher->hasher(set->keys[i]);
+
+	double low = bucket_z(hashes, set->count, 0);
+	double high = bucket_z(hashes, set->count, 1);
+	size_t full = count_collisions(hashes, set->count, ~(uint64_t)0);
+	size_t narrow = count_collisions(hashes, set->count, 0xFFFFFFFFu);
+
+	//Expected 32 bit collisions for n random values is about n^2 / 2^33
+	double expected = (double)set->count * set->count / 8589934592.0;
+	int bad = fabs(low) > 4 || fabs(high) > 4 || full || narrow > expected * 2 + 8;
+
+	printf("%-12s %-16s %10.1f %10.1f %8zu %8zu %9.1f  %s\n", hasher->name, set->name, low, high, full, narrow, expected, bad ? "POOR" : "ok");
+
+	free(hashes);
+	return bad && !hasher->reference;
+}
+
+//Worst bias of any output bit when flipping any single input bit, 0.5 means no mixing at all
+//A perfect hash still shows sampling noise, noise is set to the largest bias expected from that alone
+static double avalanche(size_t len, double *noise)
+{
+	unsigned char key[64];
+	size_t bits = len * 8;
+	uint32_t *flips = calloc(bits * 64, sizeof(uint32_t));
+
+	for (int s = 0; s < AVALANCHE_SAMPLES; s++)
+	{
+		for (size_t i = 0; i < len; i++)
+			key[i] = rng_next();
+
+		uint64_t base = hash_mem(key, len);
+
+		for (size_t b = 0; b < bits; b++)
+		{
+			key[b >> 3] ^= 1 << (b & 7);
+			uint64_t diff = base ^ hash_mem(key, len);
+			key[b >> 3] ^= 1 << (b & 7);
+
+			for (int o = 0; o < 64; o++)
+				flips[b * 64 + o] += (diff >> o) & 1;
+		}
+	}
+
+	double worst = 0;
+	for (size_t i = 0; i < bits * 64; i++)
+		worst = fmax(worst, fabs((double)flips[i] / AVALANCHE_SAMPLES - 0.5));
+
+	free(flips);
+	*noise = 0.5 / sqrt(AVALANCHE_SAMPLES) * sqrt(2 * log(bits * 64.0));
+	return worst;
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 200000;
+
+	bench_throughput();
+
+	keyset_t ids = { "sequential ids", malloc(count * sizeof(void *)), count };
+	keyset_t ptrs = { "aligned ptrs", malloc(count * sizeof(void *)), count };
+	keyset_t id_refs = { "sequential ids", malloc(count * sizeof(void *)), count };
+	keyset_t urls = { "urls", malloc(count * sizeof(void *)), count };
+	uint64_t *id_values = malloc(count * sizeof(uint64_t));
+	char *url_data = malloc(count * 64);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		ids.keys[i] = (void *)(uintptr_t)(i + 1);
+		ptrs.keys[i] = (void *)(uintptr_t)(0x7f0000000000ULL + i * 16);
+		id_values[i] = i + 1;
+		id_refs.keys[i] = &id_values[i];
+		snprintf(&url_data[i * 64], 64, "https://example.com/users/%zu/items?page=%zu", i / 16, i % 16);
+		urls.keys[i] = &url_data[i * 64];
+	}
+
+	hasher_t int_hashers[] = { { "identity", identity, 1 }, { "hash_ptr", hash_ptr, 0 }, { "hash_u64", hash_u64, 0 }, { "hash_u32", hash_u32, 0 } };
+	hasher_t ref_hashers[] = { { "hash_u64_ref", hash_u64_ref, 0 } };
+	hasher_t str_hashers[] = { { "legacy_x41", legacy_str, 1 }, { "hash_str", hash_str, 0 } };
+	int failed = 0;
+
+	printf("%zu keys per set, %d buckets, z-scores of bucket chi-squared using low and high hash bits\n", count, 1 << BUCKET_BITS);
+	printf("%-12s %-16s %10s %10s %8s %8s %9s\n", "hasher", "keys", "low z", "high z", "coll64", "coll32", "exp32");
+
+	for (size_t i = 0; i < sizeof(int_hashers) / sizeof(int_hashers[0]); i++)
+	{
+		failed |= quality_row(&int_hashers[i], &ids);
+		failed |= quality_row(&int_hashers[i], &ptrs);
+	}
+
+	failed |= quality_row(&ref_hashers[0], &id_refs);
+
+	for (size_t i = 0; i < sizeof(str_hashers) / sizeof(str_hashers[0]); i++)
+		failed |= quality_row(&str_hashers[i], &urls);
+
+	printf("\nhash_mem avalanche, worst output bit bias over %d samples\n", AVALANCHE_SAMPLES);
+	static const size_t avalanche_sizes[] = { 4, 8, 16, 24, 64 };
+	for (size_t i = 0; i < sizeof(avalanche_sizes) / sizeof(avalanche_sizes[0]); i++)
+	{
+		double noise, bias = avalanche(avalanche_sizes[i], &noise);
+		int bad = bias > noise * 1.25;
+		printf("%4zu bytes: %.4f (noise %.4f)  %s\n", avalanche_sizes[i], bias, noise, bad ? "POOR" : "ok");
+		failed |= bad;
+	}
+
+	free(ids.keys);
+	free(ptrs.keys);
+	free(id_refs.keys);
+	free(urls.keys);
+	free(id_values);
+	free(url_data);
+
+	if (failed) printf("\nFAILED, a hasher rated POOR\n");
+	return failed ? 1 : 0;
+}
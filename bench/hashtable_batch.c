@@ -0,0 +1,80 @@
+//hashtable_batch.c - hashtable_get loop against hashtable_get_many on a table bigger than the LLC
+//Usage: hashtable_batch [entries] [lookups]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hashtable.h"
+#include "hashes.h"
+
+#define BATCH 256
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	size_t entries = argc > 1 ? strtoull(argv[1], NULL, 10) : 4000000;
+	size_t lookups = argc > 2 ? strtoull(argv[2], NULL, 10) : 4000000;
+
+	hashtable_t *table = hashtable_create(hash_ptr, compare_ptr);
+	void **keys = malloc(entries * sizeof(void *));
+	void **queries = malloc(lookups * sizeof(void *));
+	void **values = malloc(lookups * sizeof(void *));
+	if (!table || !keys || !queries || !values) { fprintf(stderr, "Allocation failed\n"); return 1; }
+
+	for (size_t i = 0; i < entries; i++)
+	{
+		keys[i] = (void *)(uintptr_t)(rng_next() | 1);
+		hashtable_add(table, keys[i], keys[i]);
+	}
+
+	for (size_t i = 0; i < lookups; i++)
+		queries[i] = keys[rng_next() % entries];
+
+	double start = now();
+	for (size_t i = 0; i < lookups; i++)
+		values[i] = hashtable_get(table, queries[i]);
+	double single = now() - start;
+
+	size_t misses = 0;
+	for (size_t i = 0; i < lookups; i++)
+		misses += values[i] != queries[i];
+
+	start = now();
+	for (size_t i = 0; i < lookups; i += BATCH)
+		hashtable_get_many(table, &queries[i], lookups - i < BATCH ? lookups - i : BATCH, &values[i]);
+	double batched = now() - start;
+
+	for (size_t i = 0; i < lookups; i++)
+		misses += values[i] != queries[i];
+
+	printf("entries: %zu, lookups: %zu, batch: %d\n", entries, lookups, BATCH);
+	printf("hashtable_get:      %8.2f ns/lookup\n", single * 1e9 / lookups);
+	printf("hashtable_get_many: %8.2f ns/lookup\n", batched * 1e9 / lookups);
+	printf("speedup:            %8.2fx\n", single / batched);
+	if (misses) printf("WARNING: %zu wrong results\n", misses);
+
+	hashtable_destroy(table);
+	free(keys);
+	free(queries);
+	free(values);
+
+	return misses != 0;
+}
@@ -0,0 +1,133 @@
+//vector_parallel.c - Parallel iterate/filter/map/reduce against the serial loops at increasing worker counts
+//Usage: vector_parallel [elements] [work per element]
+//Every element runs a small CPU bound scoring loop, results are checked against the serial pass
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ivector.h"
+#include "parallel.h"
+
+static size_t work = 64;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t score(uint64_t x)
+{
+	for (size_t i = 0; i < work; i++)
+		x = (x ^ (x >> 31)) * 0x9e3779b97f4a7c15ULL + i;
+	return x;
+}
+
+static void score_iterate(void *elem, void *arg)
+{
+	(void)arg;
+	uint64_t *x = elem;
+	*x = score(*x);
+}
+
+static int score_match(void *elem, void *arg)
+{
+	(void)arg;
+	return score(*(uint64_t *)elem) % 3 == 0;
+}
+
+static void score_map(void *elem, void *out, void *arg)
+{
+	(void)arg;
+	*(uint64_t *)out = score(*(uint64_t *)elem);
+}
+
+static void score_fold(void *acc, void *elem, void *arg)
+{
+	(void)arg;
+	*(uint64_t *)acc += score(*(uint64_t *)elem);
+}
+
+static void sum_combine(void *acc, void *other, void *arg)
+{
+	(void)arg;
+	*(uint64_t *)acc += *(uint64_t *)other;
+}
+
+static void report(const char *op, size_t workers, double seconds, double serial)
+{
+	printf("%-10s %3zu workers %10.2f ms %6.2fx\n", op, workers, seconds * 1e3, serial / seconds);
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 2000000;
+	work = argc > 2 ? strtoull(argv[2], NULL, 10) : 64;
+
+	ivector_t *vec = ivector_create(sizeof(uint64_t));
+	ivector_t *filtered = ivector_create(sizeof(uint64_t)), *mapped = ivector_create(sizeof(uint64_t));
+	if (!vec || !filtered || !mapped || ivector_ensure(vec, count)) { fprintf(stderr, "Allocation failed\n"); return 1; }
+
+	for (uint64_t i = 0; i < count; i++)
+		ivector_append(vec, &i);
+
+	printf("%zu elements, %zu rounds of work each\n", count, work);
+
+	double start = now();
+	uint64_t expected_sum = 0;
+	size_t expected_matches = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t x = score(((uint64_t *)vec->data)[i]);
+		expected_sum += x;
+		expected_matches += x % 3 == 0;
+	}
+	double serial = now() - start;
+	report("serial", 1, serial, serial);
+
+	size_t max = parallel_get_workers();
+
+	for (size_t workers = 1; workers <= max; workers <<= 1)
+	{
+		parallel_set_workers(workers);
+
+		ivector_t *copy = ivector_duplicate(vec);
+		start = now();
+		ivector_parallel_iterate(copy, score_iterate, NULL, 0);
+		report("iterate", workers, now() - start, serial);
+		ivector_destroy(copy);
+
+		ivector_clear(filtered);
+		start = now();
+		ivector_parallel_filter(vec, score_match, NULL, filtered, 0);
+		report("filter", workers, now() - start, serial);
+
+		ivector_clear(mapped);
+		start = now();
+		ivector_parallel_map(vec, score_map, NULL, mapped, 0);
+		report("map", workers, now() - start, serial);
+
+		uint64_t sum = 0;
+		start = now();
+		ivector_parallel_reduce(vec, score_fold, sum_combine, &sum, sizeof(sum), NULL, 0);
+		report("reduce", workers, now() - start, serial);
+
+		if (sum != expected_sum || filtered->count != expected_matches || mapped->count != count)
+		{
+			fprintf(stderr, "Parallel results differ from the serial pass\n");
+			return 1;
+		}
+
+		if (workers < max && workers << 1 > max) workers = max >> 1;
+	}
+
+	parallel_set_workers(0);
+	ivector_destroy(vec);
+	ivector_destroy(filtered);
+	ivector_destroy(mapped);
+
+	return 0;
+}
@@ -0,0 +1,178 @@
+//vector_remove.c - Element by element removal/insertion against the single pass and batch versions
+//Usage: vector_remove [elements] [remove every nth]
+//Moved bytes count the element bytes shifted by memmove, the old per element loops move the whole tail every time
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "vector.h"
+#include "ivector.h"
+
+typedef struct
+{
+	uint64_t id;
+	char payload[24];
+} record_t;
+
+static size_t every = 10;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int match_ptr(void *ptr, void *arg)
+{
+	(void)arg;
+	return (uintptr_t)ptr % every == 0;
+}
+
+static int match_record(void *ptr, void *arg)
+{
+	(void)arg;
+	return ((record_t *)ptr)->id % every == 0;
+}
+
+static void report(const char *op, const char *method, double seconds, double bytes)
+{
+	printf("%-28s %-22s %10.2f ms %12.2f MB moved\n", op, method, seconds * 1e3, bytes / (1 << 20));
+}
+
+//What vector_remove_all used to do, remove_at from the back on every match
+static double legacy_remove_all(vector_t *vec, double *bytes)
+{
+	*bytes = 0;
+	double start = now();
+
+	for (size_t i = vec->count - 1; i < ~(size_t)0; i--)
+	{
+		if (match_ptr(vec->data[i], NULL))
+		{
+			*bytes += (vec->count - i - 1) * sizeof(void *);
+			vector_remove_at(vec, i);
+		}
+	}
+
+	return now() - start;
+}
+
+static double legacy_remove_all_records(ivector_t *vec, double *bytes)
+{
+	*bytes = 0;
+	double start = now();
+
+	for (size_t i = vec->count - 1; i < ~(size_t)0; i--)
+	{
+		if (match_record((char *)vec->data + i * vec->element_size, NULL))
+		{
+			*bytes += (vec->count - i - 1) * vec->element_size;
+			ivector_remove_at(vec, i);
+		}
+	}
+
+	return now() - start;
+}
+
+//Single pass compaction moves every kept element after the first removed one exactly once, index 0 is always removed
+static double compact_bytes(size_t count, size_t element_size)
+{
+	return (double)(count - (count + every - 1) / every) * element_size;
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 200000;
+	every = argc > 2 ? strtoull(argv[2], NULL, 10) : 10;
+	if (!every) every = 1;
+
+	vector_t *a = vector_create(), *b;
+	ivector_t *ra = ivector_create(sizeof(record_t)), *rb;
+	if (!a || !ra) { fprintf(stderr, "Allocation failed\n"); return 1; }
+
+	for (size_t i = 0; i < count; i++)
+	{
+		record_t record = { i, { 0 } };
+		vector_append(a, (void *)(uintptr_t)i);
+		ivector_append(ra, &record);
+	}
+
+	printf("%zu elements, removing every %zuth\n", count, every);
+
+	double bytes, seconds;
+	b = vector_duplicate(a);
+	rb = ivector_duplicate(ra);
+
+	seconds = legacy_remove_all(b, &bytes);
+	report("vector remove_all", "remove_at loop", seconds, bytes);
+	vector_destroy(b);
+
+	b = vector_duplicate(a);
+	seconds = now();
+	vector_remove_all(b, match_ptr, NULL);
+	report("vector remove_all", "single pass", now() - seconds, compact_bytes(count, sizeof(void *)));
+	vector_destroy(b);
+
+	seconds = legacy_remove_all_records(rb, &bytes);
+	report("ivector remove_all (32 B)", "remove_at loop", seconds, bytes);
+	ivector_destroy(rb);
+
+	rb = ivector_duplicate(ra);
+	seconds = now();
+	ivector_remove_all(rb, match_record, NULL);
+	report("ivector remove_all (32 B)", "single pass", now() - seconds, compact_bytes(count, sizeof(record_t)));
+	ivector_destroy(rb);
+
+	size_t *indices = malloc(count * sizeof(size_t));
+	size_t index_count = 0;
+	for (size_t i = 0; i < count; i += every)
+		indices[index_count++] = i;
+
+	b = vector_duplicate(a);
+	bytes = 0;
+	seconds = now();
+	for (size_t i = index_count; i-- > 0;)
+	{
+		bytes += (b->count - indices[i] - 1) * sizeof(void *);
+		vector_remove_at(b, indices[i]);
+	}
+	report("vector remove indices", "remove_at loop", now() - seconds, bytes);
+	vector_destroy(b);
+
+	b = vector_duplicate(a);
+	seconds = now();
+	vector_remove_indices(b, indices, index_count);
+	report("vector remove indices", "remove_indices", now() - seconds, compact_bytes(count, sizeof(void *)));
+	vector_destroy(b);
+
+	//Inserting count / every elements at the front
+	size_t inserted = count / every;
+	vector_t *src = vector_from_range(a, 0, inserted);
+
+	b = vector_duplicate(a);
+	bytes = 0;
+	seconds = now();
+	for (size_t i = 0; i < inserted; i++)
+	{
+		bytes += (b->count - i) * sizeof(void *);
+		vector_insert_at(b, src->data[i], i);
+	}
+	report("vector insert at front", "insert_at loop", now() - seconds, bytes);
+	vector_destroy(b);
+
+	b = vector_duplicate(a);
+	seconds = now();
+	vector_insert_vector_at(b, src, 0);
+	report("vector insert at front", "insert_vector_at", now() - seconds, (double)count * sizeof(void *));
+	vector_destroy(b);
+
+	vector_destroy(src);
+	free(indices);
+	vector_destroy(a);
+	ivector_destroy(ra);
+
+	return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef SUS_CHASHTABLE_H_
+#define SUS_CHASHTABLE_H_
+
+#include <stddef.h>
+
+//Concurrent counterpart of hashtable_t, every function may be called from any thread except destroy
+//Lookups never block, writers only lock the stripe their key hashes to
+typedef struct chashtable_t chashtable_t;
+
+chashtable_t *chashtable_create(size_t (*hasher)(void*), int (*comparer)(void*, void*));
+//Must not race with any other call on the table
+int chashtable_destroy(chashtable_t *table);
+int chashtable_destroy_free(chashtable_t *table, void (*free_key)(void *), void (*free_value)(void *));
+
+int chashtable_add(chashtable_t *table, void *key, void *value);
+void *chashtable_get(chashtable_t *table, void *key);
+//Concurrent lookups may still be reading the removed key/value, release them through chashtable_retire
+int chashtable_remove(chashtable_t *table, void *key, void **removed_key, void **removed_content);
+
+size_t chashtable_get_count(chashtable_t *table);
+int chashtable_has_key(chashtable_t *table, void* key);
+
+//Calls freer(ptr) once no thread can still be inside a lookup that started before this call
+int chashtable_retire(chashtable_t *table, void *ptr, void (*freer)(void *));
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SUS_DEQUE_H_
+#define SUS_DEQUE_H_
+
+#include <stddef.h>
+
+#define DEQUE_DEFAULT_CAP 4
+
+//Ring buffer of pointers, element i lives at data[(head + i) & (capacity - 1)], capacity is always a power of two
+typedef struct
+{
+	void **data;
+	size_t capacity;
+	size_t head;
+	size_t count;
+} deque_t;
+
+deque_t *deque_create();
+int deque_destroy(deque_t *deque);
+int deque_destroy_free(deque_t *deque, void (*freer)(void *));
+deque_t *deque_duplicate(deque_t *deque);
+
+int deque_ensure(deque_t *deque, size_t capacity);
+int deque_trim(deque_t *deque);
+
+int deque_push_back(deque_t *deque, void *data);
+int deque_push_front(deque_t *deque, void *data);
+//Popped element is written to data unless it is NULL
+int deque_pop_back(deque_t *deque, void **data);
+int deque_pop_front(deque_t *deque, void **data);
+//Shift whichever side of index is shorter
+int deque_insert_at(deque_t *deque, void *data, size_t index);
+int deque_remove_at(deque_t *deque, size_t index);
+int deque_clear(deque_t *deque);
+
+//NULL when index is out of range
+void *deque_get(deque_t *deque, size_t index);
+int deque_set(deque_t *deque, size_t index, void *data);
+void *deque_front(deque_t *deque);
+void *deque_back(deque_t *deque);
+
+int deque_iterate(deque_t *deque, void (*func)(void *));
+
+#endif
@@ -4,11 +4,29 @@
 #include <stddef.h>
 #include <stdint.h>
 
+//Seeds hash_str and hash_mem, set it (eg: randomly) before filling any table with untrusted keys
+void hash_set_seed(uint64_t seed);
+//Hashes len bytes at ptr, 48 bytes per iteration on long keys
+size_t hash_mem(const void *ptr, size_t len);
+uint64_t hash_mem_seed(const void *ptr, size_t len, uint64_t seed);
+
+//Same as hash_mem over the string without its terminator
 size_t hash_str(void *ptr);
 int compare_str(void *ptr1, void *ptr2);
-//Used when casting key to void*
+//Used when casting key to void*, pointer bits are mixed so aligned pointers spread evenly
 size_t hash_ptr(void *ptr);
 //Used when casting key to void*
 int compare_ptr(void *ptr1, void *ptr2);
 
+//Integer keys cast to void*, u32 only looks at the low 32 bits
+size_t hash_u32(void *ptr);
+int compare_u32(void *ptr1, void *ptr2);
+size_t hash_u64(void *ptr);
+int compare_u64(void *ptr1, void *ptr2);
+//Integer keys passed by address, for when they do not fit in a pointer
+size_t hash_u32_ref(void *ptr);
+int compare_u32_ref(void *ptr1, void *ptr2);
+size_t hash_u64_ref(void *ptr);
+int compare_u64_ref(void *ptr1, void *ptr2);
+
 #endif
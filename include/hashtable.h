@@ -2,25 +2,95 @@
 #define SUS_HASHTABLE_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "vector.h"
 
+//Grow by moving a few buckets on every add/get/remove instead of all at once
+#define HASHTABLE_FLAG_INCREMENTAL 0x1
+//Use power of two bucket counts, hashes are finalized and masked instead of taken modulo a prime
+#define HASHTABLE_FLAG_POW2 0x2
+
+//Buckets moved per operation while an incremental resize is in progress
+#define HASHTABLE_INCREMENTAL_STEP 16
+
+//Entries per bucket above which a table grows, shrinking happens below a quarter of it
+#define HASHTABLE_DEFAULT_MAX_LOAD 0.5
+
+//Chain lengths tracked by hashtable_stats_t, the last slot counts anything longer
+#define HASHTABLE_STATS_CHAINS 16
+
+//hashtable_foreach callback results, may be or'd together
+#define HASHTABLE_ITER_CONTINUE 0x0
+#define HASHTABLE_ITER_REMOVE 0x1
+#define HASHTABLE_ITER_STOP 0x2
+
 typedef struct hashtable_t hashtable_t;
 
+//Cursor over all entries, the table must not be modified through anything but hashtable_iter_remove while in use
+typedef struct
+{
+	hashtable_t *table;
+	size_t bucket;
+	void *link;
+	void *entry;
+} hashtable_iter_t;
+
+typedef struct
+{
+	size_t count;
+	size_t capacity;
+	double load_factor;
+	size_t max_chain;
+	double avg_chain; //Over non empty buckets
+	size_t chain_histogram[HASHTABLE_STATS_CHAINS]; //Number of buckets holding i entries
+	size_t bucket_bytes;
+	size_t node_bytes;
+	//Only counted when the library is built with SUS_HASHTABLE_STATS, zero otherwise
+	size_t lookups;
+	size_t comparer_calls;
+	size_t resizes;
+	//Incremental tables add every migration step to resize_ns, max_resize_ns is then the longest single pause
+	uint64_t resize_ns;
+	uint64_t max_resize_ns;
+} hashtable_stats_t;
+
 hashtable_t *hashtable_create(size_t (*hasher)(void*), int (*comparer)(void*, void*));
+hashtable_t *hashtable_create_ex(size_t (*hasher)(void*), int (*comparer)(void*, void*), int flags);
+//Sized to hold count entries without growing, it will not shrink below that either
+hashtable_t *hashtable_create_with_capacity(size_t (*hasher)(void*), int (*comparer)(void*, void*), size_t count, int flags);
 int hashtable_destroy(hashtable_t *table);
 int hashtable_destroy_free(hashtable_t *table, void (*free_key)(void *), void (*free_value)(void *));
 
 int hashtable_add(hashtable_t *table, void *key, void *value);
+//Both hash once and return the value slot of key, which stays valid until the entry is removed
+void **hashtable_get_or_insert(hashtable_t *table, void *key, void *value, int *inserted);
+void **hashtable_upsert(hashtable_t *table, void *key, void *value, void **old_value);
 void *hashtable_get(hashtable_t *table, void *key);
+//Batched lookups, missing keys yield NULL/SUS_FALSE in their output slot
+int hashtable_get_many(hashtable_t *table, void **keys, size_t count, void **values);
 int hashtable_remove(hashtable_t *table, void *key, void **removed_key, void **removed_content);
 
 size_t hashtable_get_count(hashtable_t *table);
 int hashtable_has_key(hashtable_t *table, void* key);
+int hashtable_has_keys(hashtable_t *table, void **keys, size_t count, int *results);
 
 vector_t *hashtable_list_keys(hashtable_t *table);
 vector_t *hashtable_list_contents(hashtable_t *table);
 
+int hashtable_iter_begin(hashtable_t *table, hashtable_iter_t *iter);
+int hashtable_iter_next(hashtable_iter_t *iter, void **key, void **value);
+//Removes the entry last returned by hashtable_iter_next
+int hashtable_iter_remove(hashtable_iter_t *iter, void **removed_key, void **removed_content);
+int hashtable_foreach(hashtable_t *table, int (*func)(void *, void *, void *), void *arg);
+
 int hashtable_resize(hashtable_t *table, size_t capacity);
+//Makes room for count entries and keeps it, automatic shrinking will not go below it
+//SUS_FAILED_ALLOC when count under the current max load needs more buckets than size_t can address
+int hashtable_reserve(hashtable_t *table, size_t count);
+int hashtable_set_max_load(hashtable_t *table, double max_load);
+
+//Walks every bucket to build the chain histogram, meant for periodic export rather than hot paths
+int hashtable_get_stats(hashtable_t *table, hashtable_stats_t *stats);
 
 #endif
@@ -0,0 +1,27 @@
+#ifndef SUS_HSNAPSHOT_H_
+#define SUS_HSNAPSHOT_H_
+
+#include <stddef.h>
+
+#include "hashtable.h"
+
+//Read only hashtable served straight from a memory mapped file, see hsnapshot_save
+typedef struct hsnapshot_t hsnapshot_t;
+
+//Writes every entry of table to path, key_size/value_size give how many bytes each key/value points to (eg: strlen + 1)
+//hasher is stored nowhere, the same one must be given to hsnapshot_open
+//Written to path.tmp and renamed over path, processes with the old file mapped keep reading it until they reopen
+int hsnapshot_save(hashtable_t *table, const char *path, size_t (*hasher)(void*), size_t (*key_size)(void*), size_t (*value_size)(void*));
+
+//hasher must hash exactly as it did on save, including the hash_set_seed seed for hash_str/hash_mem
+//A few stored keys are rehashed to check this, NULL is returned on a mismatch or a corrupt header
+//Only the header is read up front, a corrupt bucket or entry makes the lookups reaching it miss
+hsnapshot_t *hsnapshot_open(const char *path, size_t (*hasher)(void*), int (*comparer)(void*, void*));
+int hsnapshot_close(hsnapshot_t *snapshot);
+
+//Returned pointers point into the mapping and are valid until hsnapshot_close
+void *hsnapshot_get(hsnapshot_t *snapshot, void *key, size_t *value_size);
+int hsnapshot_has_key(hsnapshot_t *snapshot, void *key);
+size_t hsnapshot_get_count(hsnapshot_t *snapshot);
+
+#endif
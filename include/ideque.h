@@ -0,0 +1,43 @@
+#ifndef SUS_IDEQUE_H_
+#define SUS_IDEQUE_H_
+
+#include <stddef.h>
+
+#define IDEQUE_DEFAULT_CAP 4
+
+//Ring buffer of inline elements, same layout as deque_t with element_size byte slots
+typedef struct
+{
+	void *data;
+	size_t capacity;
+	size_t head;
+	size_t count;
+	size_t element_size;
+} ideque_t;
+
+ideque_t *ideque_create(size_t element_size);
+int ideque_destroy(ideque_t *deque);
+ideque_t *ideque_duplicate(ideque_t *deque);
+
+int ideque_ensure(ideque_t *deque, size_t capacity);
+int ideque_trim(ideque_t *deque);
+
+int ideque_push_back(ideque_t *deque, void *data);
+int ideque_push_front(ideque_t *deque, void *data);
+//Popped element is copied to data unless it is NULL
+int ideque_pop_back(ideque_t *deque, void *data);
+int ideque_pop_front(ideque_t *deque, void *data);
+//Shift whichever side of index is shorter
+int ideque_insert_at(ideque_t *deque, void *data, size_t index);
+int ideque_remove_at(ideque_t *deque, size_t index);
+int ideque_clear(ideque_t *deque);
+
+//Pointers into the buffer, NULL when index is out of range, invalidated by anything that grows or trims
+void *ideque_get(ideque_t *deque, size_t index);
+int ideque_set(ideque_t *deque, size_t index, void *data);
+void *ideque_front(ideque_t *deque);
+void *ideque_back(ideque_t *deque);
+
+int ideque_iterate(ideque_t *deque, void (*func)(void *));
+
+#endif
@@ -4,6 +4,32 @@
 #include <stddef.h>
 
 #define IVECTOR_DEFAULT_CAP 4
+//Vectors at least this long are sorted on every CPU
+#define IVECTOR_SORT_PARALLEL_MIN 65536
+
+//Key types for ivector_radix_sort, unsigned unless SIGNED or FLOAT is given
+#define IVECTOR_RADIX_UNSIGNED 0x0
+#define IVECTOR_RADIX_SIGNED 0x1
+#define IVECTOR_RADIX_FLOAT 0x2
+//Count and scatter on every CPU when the vector is at least IVECTOR_SORT_PARALLEL_MIN long
+#define IVECTOR_RADIX_PARALLEL 0x4
+
+//data belongs to the caller, the vector moves to the heap instead of growing it and never frees it
+#define IVECTOR_FLAG_BORROWED 0x1
+//data is a private anonymous mapping, grown and shrunk with mremap
+#define IVECTOR_FLAG_MAPPED 0x2
+//Growth policy, set with ivector_set_growth, doubling by default
+//Ask for transparent huge pages whenever the storage gets mapped
+#define IVECTOR_FLAG_HUGE_PAGES 0x4
+//Grow by half the capacity instead of doubling
+#define IVECTOR_FLAG_GROW_HALF 0x8
+//Once the storage reaches IVECTOR_GROW_STEP bytes, grow in whole steps of that size
+#define IVECTOR_FLAG_GROW_STEP 0x10
+#define IVECTOR_GROWTH_FLAGS (IVECTOR_FLAG_HUGE_PAGES | IVECTOR_FLAG_GROW_HALF | IVECTOR_FLAG_GROW_STEP)
+
+//Storage of at least this many bytes is mapped directly, so growing it moves pages instead of copying them
+#define IVECTOR_MAP_MIN ((size_t)32 << 20)
+#define IVECTOR_GROW_STEP ((size_t)256 << 20)
 
 typedef struct
 {
@@ -11,15 +37,29 @@ typedef struct
 	size_t capacity;
 	size_t count;
 	size_t element_size;
+	int flags;
 } ivector_t;
 
+//A vector whose first n elements of type T live in the struct itself, set up with ivector_init_small
+//The struct must not be copied or moved while the vector still uses buf
+#define IVECTOR_SMALL(T, n) struct { ivector_t vec; T buf[n]; }
+#define ivector_init_small(small) ivector_init_buffer(&(small)->vec, sizeof((small)->buf[0]), (small)->buf, sizeof((small)->buf) / sizeof((small)->buf[0]))
+
 ivector_t *ivector_create(size_t element_size);
+//In place setup for vectors on the stack or embedded in other structs, nothing is allocated until the first growth
+int ivector_init(ivector_t *vec, size_t element_size);
+//Starts on capacity elements of caller owned storage, spills to the heap once more are needed
+int ivector_init_buffer(ivector_t *vec, size_t element_size, void *buf, size_t capacity);
+//Frees whatever heap storage an initialized vector picked up and leaves it empty
+int ivector_deinit(ivector_t *vec);
 int ivector_destroy(ivector_t *vec);
 ivector_t *ivector_duplicate(ivector_t *vec);
 ivector_t *ivector_from_range(ivector_t *vec, size_t start, size_t count);
 
 int ivector_ensure(ivector_t *vec, size_t capacity);
 int ivector_trim(ivector_t *vec);
+//flags is any combination of the growth flags, replaces the previous policy
+int ivector_set_growth(ivector_t *vec, int flags);
 
 int ivector_append(ivector_t *vec, void *data);
 int ivector_append_vector(ivector_t *vec, ivector_t *src);
@@ -30,12 +70,54 @@ int ivector_pop_back(ivector_t *vec);
 int ivector_insert_at(ivector_t *vec, void *data, size_t index);
 int ivector_remove_at(ivector_t *vec, size_t index);
 int ivector_remove_range(ivector_t *vec, size_t start, size_t count);
+//Insert count elements of src starting at start before index, the tail is shifted once, src may be vec
+int ivector_insert_range_at(ivector_t *vec, ivector_t *src, size_t start, size_t count, size_t index);
+int ivector_insert_vector_at(ivector_t *vec, ivector_t *src, size_t index);
+//indices must be strictly ascending, every kept element moves at most once
+int ivector_remove_indices(ivector_t *vec, const size_t *indices, size_t count);
 int ivector_clear(ivector_t *vec);
 
 int ivector_iterate(ivector_t *vec, void (*func)(void *));
 ivector_t *ivector_get_all(ivector_t *vec, int (*match)(void *, void *), void *arg);
+//Appends the matches to out instead of allocating a new vector
+int ivector_get_all_into(ivector_t *vec, int (*match)(void *, void *), void *arg, ivector_t *out);
+//Both keep the order of the remaining elements and run in a single pass
 size_t ivector_remove(ivector_t *vec, void *data);
 size_t ivector_remove_all(ivector_t *vec, int (*match)(void *, void *), void *arg);
+//Parallel versions run chunks of grain elements (0 for PARALLEL_DEFAULT_GRAIN) on the pool from parallel.h
+//Callbacks run concurrently and get arg as their last parameter
+int ivector_parallel_iterate(ivector_t *vec, void (*func)(void *, void *), void *arg, size_t grain);
+//Appends the matches to out in their original order, match is called once per element
+int ivector_parallel_filter(ivector_t *vec, int (*match)(void *, void *), void *arg, ivector_t *out, size_t grain);
+//Appends one element of out->element_size per element, func(elem, result, arg) fills result in place
+int ivector_parallel_map(ivector_t *vec, void (*func)(void *, void *, void *), void *arg, ivector_t *out, size_t grain);
+//acc holds acc_size bytes and must start as the identity of combine, every chunk folds into its own copy of it
+//fold(acc, elem, arg) adds an element, combine(acc, other, arg) merges chunk results into acc in chunk order
+int ivector_parallel_reduce(ivector_t *vec, void (*fold)(void *, void *, void *), void (*combine)(void *, void *, void *), void *acc, size_t acc_size, void *arg, size_t grain);
+//Introsort, equal elements may end up in any order, comparer gets pointers to the elements
 ivector_t *ivector_sort(ivector_t *vec, int (*comparer)(void *, void *));
+//Merge sort, keeps equal elements in their original order, needs count elements of scratch memory (NULL if unavailable)
+ivector_t *ivector_sort_stable(ivector_t *vec, int (*comparer)(void *, void *));
+//Stable LSD radix sort on the key_width (1, 2, 4 or 8) byte integer or float found key_offset bytes into each element
+//Needs count elements of scratch memory, bytes all elements agree on are skipped, floats sort -0.0 before 0.0
+int ivector_radix_sort(ivector_t *vec, size_t key_offset, size_t key_width, int flags);
+
+//Sorted vectors, comparer(elem, key) must order them the way they were sorted, key is a pointer to an element
+size_t ivector_lower_bound(ivector_t *vec, void *key, int (*comparer)(void *, void *));
+size_t ivector_upper_bound(ivector_t *vec, void *key, int (*comparer)(void *, void *));
+//SUS_TRUE if key is present, index gets the first match or where key would be inserted
+int ivector_binary_search(ivector_t *vec, void *key, int (*comparer)(void *, void *), size_t *index);
+//Inserts after any equal elements
+int ivector_insert_sorted(ivector_t *vec, void *data, int (*comparer)(void *, void *));
+//Leaves the vector alone if an equal element is present, inserted tells which happened
+int ivector_insert_sorted_unique(ivector_t *vec, void *data, int (*comparer)(void *, void *), int *inserted);
+//Keeps the first of every run of equal elements, returns how many were removed
+size_t ivector_unique(ivector_t *vec, int (*comparer)(void *, void *));
+//Append to out, which must be neither a nor b, equal elements pair up one to one and are taken from a
+int ivector_set_union(ivector_t *a, ivector_t *b, int (*comparer)(void *, void *), ivector_t *out);
+int ivector_set_intersect(ivector_t *a, ivector_t *b, int (*comparer)(void *, void *), ivector_t *out);
+int ivector_set_difference(ivector_t *a, ivector_t *b, int (*comparer)(void *, void *), ivector_t *out);
+//Appends the stable merge of count sorted vectors to out through a heap of their heads
+int ivector_merge_sorted(ivector_t **srcs, size_t count, int (*comparer)(void *, void *), ivector_t *out);
 
 #endif
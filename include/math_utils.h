@@ -1,8 +1,25 @@
 #ifndef SUS_MATH_UTILS_H_
 #define SUS_MATH_UTILS_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define MAX(a,b) ((a) < (b) ? (b) : (a))
 #define MIN(a,b) ((a) > (b) ? (b) : (a))
 #define DIV_CEIL(a, b) ((((a) + (b) - 1) / (b)))
 
+//Smallest power of two not below value or min (itself a power of two), 0 when it does not fit in size_t
+static inline size_t round_pow2(size_t value, size_t min)
+{
+	size_t pow2 = min;
+
+	while (pow2 < value)
+	{
+		if (pow2 > SIZE_MAX >> 1) return 0;
+		pow2 <<= 1;
+	}
+
+	return pow2;
+}
+
 #endif
@@ -0,0 +1,29 @@
+#ifndef SUS_OHASHTABLE_H_
+#define SUS_OHASHTABLE_H_
+
+#include <stddef.h>
+
+#include "vector.h"
+
+//Open addressing counterpart of hashtable_t, same semantics but entries live in flat arrays
+typedef struct ohashtable_t ohashtable_t;
+
+ohashtable_t *ohashtable_create(size_t (*hasher)(void*), int (*comparer)(void*, void*));
+int ohashtable_destroy(ohashtable_t *table);
+int ohashtable_destroy_free(ohashtable_t *table, void (*free_key)(void *), void (*free_value)(void *));
+
+int ohashtable_add(ohashtable_t *table, void *key, void *value);
+void *ohashtable_get(ohashtable_t *table, void *key);
+int ohashtable_remove(ohashtable_t *table, void *key, void **removed_key, void **removed_content);
+
+size_t ohashtable_get_count(ohashtable_t *table);
+int ohashtable_has_key(ohashtable_t *table, void* key);
+
+vector_t *ohashtable_list_keys(ohashtable_t *table);
+vector_t *ohashtable_list_contents(ohashtable_t *table);
+
+//Capacity is rounded up to a power of two, fails if it cannot hold the current entries
+//SUS_FAILED_ALLOC when the rounded capacity would not fit in size_t
+int ohashtable_resize(ohashtable_t *table, size_t capacity);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SUS_PARALLEL_H_
+#define SUS_PARALLEL_H_
+
+#include <stddef.h>
+
+//Elements per task when a parallel function is given a grain of 0
+#define PARALLEL_DEFAULT_GRAIN 4096
+
+//Threads of the internal pool shared by the parallel vector functions and the parallel sorts
+//count caps how many threads work on a single call, 0 goes back to one per online CPU
+int parallel_set_workers(size_t count);
+size_t parallel_get_workers(void);
+
+#endif
@@ -0,0 +1,233 @@
+//thashtable.h - Typed hashtables generated from macros
+//Keys and values are stored inline and hash/equality are expanded in place, no function pointers involved
+//
+//Example:
+//  SUS_HASHTABLE_DEFINE(u64map, uint64_t, uint32_t, SUS_HASHTABLE_HASH_INT, SUS_HASHTABLE_EQ)
+//  u64map_t *map = u64map_create();
+//  u64map_put(map, 42, 7);
+//  uint32_t *value = u64map_get(map, 42);
+
+#ifndef SUS_THASHTABLE_H_
+#define SUS_THASHTABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sus.h"
+
+#define SUS_HASHTABLE_DEFAULT_CAP 16
+
+//Identity hash for integer keys, slots are picked by fibonacci hashing so the hash may be weak
+#define SUS_HASHTABLE_HASH_INT(key) ((uint64_t)(key))
+#define SUS_HASHTABLE_EQ(a, b) ((a) == (b))
+
+//Declares name##_t, a linear probing table holding key_t -> value_t
+//hash_fn(key) must return an integer, eq_fn(a, b) non-zero when both keys are equal
+#define SUS_HASHTABLE_DEFINE(name, key_t, value_t, hash_fn, eq_fn) \
+typedef struct \
+{ \
+	key_t *keys; \
+	value_t *values; \
+	uint8_t *used; \
+	size_t capacity; \
+	size_t count; \
+	unsigned shift; \
+} name##_t; \
+\
+static inline size_t name##_slot(const name##_t *table, key_t key) \
+{ \
+	return (size_t)(((uint64_t)(hash_fn(key)) * 0x9E3779B97F4A7C15ULL) >> table->shift); \
+} \
+\
+/*Returns the slot holding key, or capacity if not found*/ \
+static inline size_t name##_find(const name##_t *table, key_t key) \
+{ \
+	size_t mask = table->capacity - 1; \
+\
+	for (size_t i = name##_slot(table, key); table->used[i]; i = (i + 1) & mask) \
+		if (eq_fn(table->keys[i], key)) \
+			return i; \
+\
+	return table->capacity; \
+} \
+\
+static inline int name##_resize(name##_t *table, size_t capacity) \
+{ \
+	if (!table) return SUS_INVALID_ARG; \
+\
+	size_t target = SUS_HASHTABLE_DEFAULT_CAP; \
+	while (target < capacity) target <<= 1; \
+	if (table->count * 4 > target * 3) return SUS_INVALID_ARG; \
+\
+	key_t *keys = malloc(target * sizeof(key_t)); \
+	value_t *values = malloc(target * sizeof(value_t)); \
+	uint8_t *used = calloc(target, 1); \
+	if (!keys || !values || !used) { free(keys); free(values); free(used); return SUS_FAILED_ALLOC; } \
+\
+	key_t *old_keys = table->keys; \
+	value_t *old_values = table->values; \
+	uint8_t *old_used = table->used; \
+	size_t old_capacity = table->capacity; \
+\
+	table->keys = keys; \
+	table->values = values; \
+	table->used = used; \
+	table->capacity = target; \
+	table->shift = 64; \
+	for (size_t cap = target; cap > 1; cap >>= 1) table->shift--; \
+\
+	for (size_t i = 0; i < old_capacity; i++) \
+	{ \
+		if (!old_used[i]) continue; \
+\
+		size_t j = name##_slot(table, old_keys[i]); \
+		while (used[j]) j = (j + 1) & (target - 1); \
+\
+		used[j] = 1; \
+		keys[j] = old_keys[i]; \
+		values[j] = old_values[i]; \
+	} \
+\
+	free(old_keys); \
+	free(old_values); \
+	free(old_used); \
+	return SUS_SUCCESS; \
+} \
+\
+static inline name##_t *name##_create(void) \
+{ \
+	name##_t *table = malloc(sizeof(name##_t)); \
+	if (!table) return NULL; \
+\
+	table->keys = NULL; \
+	table->values = NULL; \
+	table->used = NULL; \
+	table->capacity = 0; \
+	table->count = 0; \
+\
+	if (name##_resize(table, SUS_HASHTABLE_DEFAULT_CAP)) { free(table); return NULL; } \
+\
+	return table; \
+} \
+\
+static inline int name##_destroy(name##_t *table) \
+{ \
+	if (!table) return SUS_INVALID_ARG; \
+\
+	free(table->keys); \
+	free(table->values); \
+	free(table->used); \
+	free(table); \
+\
+	return SUS_SUCCESS; \
+} \
+\
+/*Returns the value slot of key, inserting value first if key is missing*/ \
+static inline value_t *name##_get_or_insert(name##_t *table, key_t key, value_t value, int *inserted) \
+{ \
+	if (!table) return NULL; \
+\
+	size_t i = name##_slot(table, key); \
+\
+	for (; table->used[i]; i = (i + 1) & (table->capacity - 1)) \
+	{ \
+		if (eq_fn(table->keys[i], key)) \
+		{ \
+			if (inserted) *inserted = SUS_FALSE; \
+			return &table->values[i]; \
+		} \
+	} \
+\
+	if ((table->count + 1) * 4 > table->capacity * 3) /*Grow past 75% fill*/ \
+	{ \
+		if (name##_resize(table, table->capacity << 1)) return NULL; \
+\
+		i = name##_slot(table, key); \
+		while (table->used[i]) i = (i + 1) & (table->capacity - 1); \
+	} \
+\
+	table->used[i] = 1; \
+	table->keys[i] = key; \
+	table->values[i] = value; \
+	table->count++; \
+\
+	if (inserted) *inserted = SUS_TRUE; \
+	return &table->values[i]; \
+} \
+\
+/*Inserts key or overwrites its value*/ \
+static inline int name##_put(name##_t *table, key_t key, value_t value) \
+{ \
+	if (!table) return SUS_INVALID_ARG; \
+\
+	value_t *slot = name##_get_or_insert(table, key, value, NULL); \
+	if (!slot) return SUS_FAILED_ALLOC; \
+\
+	*slot = value; \
+	return SUS_SUCCESS; \
+} \
+\
+static inline value_t *name##_get(name##_t *table, key_t key) \
+{ \
+	if (!table) return NULL; \
+\
+	size_t i = name##_find(table, key); \
+	return i != table->capacity ? &table->values[i] : NULL; \
+} \
+\
+static inline int name##_has_key(name##_t *table, key_t key) \
+{ \
+	if (!table) return SUS_INVALID_ARG; \
+\
+	return name##_find(table, key) != table->capacity ? SUS_TRUE : SUS_FALSE; \
+} \
+\
+static inline int name##_remove(name##_t *table, key_t key, key_t *removed_key, value_t *removed_value) \
+{ \
+	if (!table) return SUS_INVALID_ARG; \
+\
+	size_t i = name##_find(table, key), mask = table->capacity - 1; \
+	if (i == table->capacity) return SUS_ENTRY_NOT_FOUND; \
+\
+	if (removed_key) *removed_key = table->keys[i]; \
+	if (removed_value) *removed_value = table->values[i]; \
+\
+	/*Backward shift deletion, later entries of the run move into the hole unless it is before their home slot*/ \
+	for (size_t j = (i + 1) & mask; table->used[j]; j = (j + 1) & mask) \
+	{ \
+		size_t home = name##_slot(table, table->keys[j]); \
+\
+		if (((j - home) & mask) >= ((j - i) & mask)) \
+		{ \
+			table->keys[i] = table->keys[j]; \
+			table->values[i] = table->values[j]; \
+			i = j; \
+		} \
+	} \
+\
+	table->used[i] = 0; \
+	table->count--; \
+	return SUS_SUCCESS; \
+} \
+\
+static inline size_t name##_get_count(name##_t *table) \
+{ \
+	if (!table) return 0; \
+\
+	return table->count; \
+} \
+\
+static inline int name##_foreach(name##_t *table, void (*func)(key_t *, value_t *, void *), void *arg) \
+{ \
+	if (!table) return SUS_INVALID_ARG; \
+	if (!func) return SUS_INVALID_ARG; \
+\
+	for (size_t i = 0; i < table->capacity; i++) \
+		if (table->used[i]) \
+			func(&table->keys[i], &table->values[i], arg); \
+\
+	return SUS_SUCCESS; \
+}
+
+#endif
@@ -0,0 +1,325 @@
+//tvector.h - Typed ivectors generated from macros
+//Elements are T instead of element_size bytes, so appends, gets and sets are plain loads and stores
+//name##_t shares its layout with ivector_t, either converts to the other for free and every ivector_ function still applies
+//
+//Example:
+//  SUS_IVECTOR_DEFINE(u64vec, uint64_t)
+//  SUS_IVECTOR_DEFINE_ORDER(u64vec, uint64_t, SUS_IVECTOR_LESS, SUS_IVECTOR_EQ)
+//  u64vec_t *vec = u64vec_create();
+//  u64vec_append(vec, 42);
+//  u64vec_sort(vec);
+
+#ifndef SUS_TVECTOR_H_
+#define SUS_TVECTOR_H_
+
+#include <stddef.h>
+
+#include "sus.h"
+#include "ivector.h"
+
+#define SUS_IVECTOR_LESS(a, b) ((a) < (b))
+#define SUS_IVECTOR_EQ(a, b) ((a) == (b))
+//Typed sorts finish ranges shorter than this with insertion sort
+#define SUS_IVECTOR_SORT_INSERTION 16
+
+//Runs the following statement with it pointing at each element of vec in turn
+#define SUS_IVECTOR_FOREACH(T, it, vec) for (T *it = (vec)->data, *it##_end = (vec)->data + (vec)->count; it < it##_end; it++)
+
+//Declares name##_t, a vector of T laid out exactly like ivector_t
+//Growth goes through ivector_ensure, so growth policies, mapped and borrowed storage behave the same
+#define SUS_IVECTOR_DEFINE(name, T) \
+typedef union \
+{ \
+	ivector_t vec; \
+	struct \
+	{ \
+		T *data; \
+		size_t capacity; \
+		size_t count; \
+		size_t element_size; \
+		int flags; \
+	}; \
+} name##_t; \
+\
+_Static_assert(sizeof(name##_t) == sizeof(ivector_t), #name "_t must have the layout of ivector_t"); \
+\
+static inline name##_t *name##_create(void) \
+{ \
+	return (name##_t *)ivector_create(sizeof(T)); \
+} \
+\
+static inline int name##_destroy(name##_t *vec) \
+{ \
+	return ivector_destroy((ivector_t *)vec); \
+} \
+\
+static inline int name##_init(name##_t *vec) \
+{ \
+	return ivector_init((ivector_t *)vec, sizeof(T)); \
+} \
+\
+static inline int name##_init_buffer(name##_t *vec, T *buf, size_t capacity) \
+{ \
+	return ivector_init_buffer((ivector_t *)vec, sizeof(T), buf, capacity); \
+} \
+\
+static inline int name##_deinit(name##_t *vec) \
+{ \
+	return ivector_deinit((ivector_t *)vec); \
+} \
+\
+static inline ivector_t *name##_as_ivector(name##_t *vec) \
+{ \
+	return (ivector_t *)vec; \
+} \
+\
+/*NULL unless vec holds elements of sizeof(T) bytes*/ \
+static inline name##_t *name##_from_ivector(ivector_t *vec) \
+{ \
+	return vec && vec->element_size == sizeof(T) ? (name##_t *)vec : NULL; \
+} \
+\
+static inline int name##_ensure(name##_t *vec, size_t capacity) \
+{ \
+	return ivector_ensure((ivector_t *)vec, capacity); \
+} \
+\
+static inline int name##_trim(name##_t *vec) \
+{ \
+	return ivector_trim((ivector_t *)vec); \
+} \
+\
+static inline int name##_append(name##_t *vec, T value) \
+{ \
+	if (!vec) return SUS_INVALID_ARG; \
+\
+	if (vec->count == vec->capacity) \
+	{ \
+		int err = ivector_ensure((ivector_t *)vec, vec->count + 1); \
+		if (err) return err; \
+	} \
+\
+	vec->data[vec->count++] = value; \
+	return SUS_SUCCESS; \
+} \
+\
+static inline int name##_append_array(name##_t *vec, const T *values, size_t count) \
+{ \
+	if (!vec) return SUS_INVALID_ARG; \
+	if (!values && count) return SUS_INVALID_ARG; \
+\
+	int err = ivector_ensure((ivector_t *)vec, vec->count + count); \
+	if (err) return err; \
+\
+	T *dst = vec->data + vec->count; \
+	for (size_t i = 0; i < count; i++) \
+		dst[i] = values[i]; \
+\
+	vec->count += count; \
+	return SUS_SUCCESS; \
+} \
+\
+/*Popped element is written to value unless it is NULL*/ \
+static inline int name##_pop_back(name##_t *vec, T *value) \
+{ \
+	if (!vec) return SUS_INVALID_ARG; \
+	if (!vec->count) return SUS_INVALID_INDEX; \
+\
+	vec->count--; \
+	if (value) *value = vec->data[vec->count]; \
+	return SUS_SUCCESS; \
+} \
+\
+/*get and set do not check index, use at for a checked pointer to the element*/ \
+static inline T name##_get(const name##_t *vec, size_t index) \
+{ \
+	return vec->data[index]; \
+} \
+\
+static inline void name##_set(name##_t *vec, size_t index, T value) \
+{ \
+	vec->data[index] = value; \
+} \
+\
+/*NULL when index is out of range*/ \
+static inline T *name##_at(name##_t *vec, size_t index) \
+{ \
+	return vec && index < vec->count ? &vec->data[index] : NULL; \
+} \
+\
+static inline int name##_clear(name##_t *vec) \
+{ \
+	if (!vec) return SUS_INVALID_ARG; \
+\
+	vec->count = 0; \
+	return SUS_SUCCESS; \
+} \
+\
+static inline int name##_iterate(name##_t *vec, void (*func)(T *)) \
+{ \
+	if (!vec) return SUS_INVALID_ARG; \
+	if (!func) return SUS_INVALID_ARG; \
+\
+	for (size_t i = 0; i < vec->count; i++) \
+		func(&vec->data[i]); \
+\
+	return SUS_SUCCESS; \
+}
+
+//Adds find, sort and binary search to a name##_t from SUS_IVECTOR_DEFINE
+//less_fn(a, b) must be non-zero when a orders before b, eq_fn(a, b) when both are equal, both get T values
+#define SUS_IVECTOR_DEFINE_ORDER(name, T, less_fn, eq_fn) \
+/*Index of the first element equal to value, or count if there is none*/ \
+static inline size_t name##_find(const name##_t *vec, T value) \
+{ \
+	size_t i = 0; \
+\
+	while (i < vec->count && !eq_fn(vec->data[i], value)) \
+		i++; \
+\
+	return i; \
+} \
+\
+static inline void name##_swap(T *a, T *b) \
+{ \
+	T tmp = *a; \
+	*a = *b; \
+	*b = tmp; \
+} \
+\
+static inline void name##_insertion_sort(T *data, size_t count) \
+{ \
+	for (size_t i = 1; i < count; i++) \
+	{ \
+		T tmp = data[i]; \
+		size_t j = i; \
+\
+		for (; j > 0 && less_fn(tmp, data[j - 1]); j--) \
+			data[j] = data[j - 1]; \
+\
+		data[j] = tmp; \
+	} \
+} \
+\
+static inline void name##_sift_down(T *data, size_t root, size_t count) \
+{ \
+	T tmp = data[root]; \
+\
+	for (;;) \
+	{ \
+		size_t child = 2 * root + 1; \
+		if (child >= count) break; \
+		if (child + 1 < count && less_fn(data[child], data[child + 1])) child++; \
+		if (!less_fn(tmp, data[child])) break; \
+\
+		data[root] = data[child]; \
+		root = child; \
+	} \
+\
+	data[root] = tmp; \
+} \
+\
+static inline void name##_heap_sort(T *data, size_t count) \
+{ \
+	for (size_t i = count / 2; i-- > 0;) \
+		name##_sift_down(data, i, count); \
+\
+	for (size_t end = count - 1; end > 0; end--) \
+	{ \
+		name##_swap(&data[0], &data[end]); \
+		name##_sift_down(data, 0, end); \
+	} \
+} \
+\
+/*Same introsort as ivector_sort with less_fn expanded in place of the comparer*/ \
+static inline void name##_introsort(T *data, size_t count, size_t depth) \
+{ \
+	while (count > SUS_IVECTOR_SORT_INSERTION) \
+	{ \
+		if (!depth--) \
+		{ \
+			name##_heap_sort(data, count); \
+			return; \
+		} \
+\
+		/*Median of three moved to the front as pivot*/ \
+		size_t mid = count / 2; \
+		if (less_fn(data[mid], data[0])) name##_swap(&data[0], &data[mid]); \
+		if (less_fn(data[count - 1], data[mid])) \
+		{ \
+			name##_swap(&data[mid], &data[count - 1]); \
+			if (less_fn(data[mid], data[0])) name##_swap(&data[0], &data[mid]); \
+		} \
+		name##_swap(&data[0], &data[mid]); \
+\
+		/*Hoare partition, both sides stop on elements equal to the pivot*/ \
+		T pivot = data[0]; \
+		size_t i = 0, j = count; \
+\
+		for (;;) \
+		{ \
+			do i++; while (i < count && less_fn(data[i], pivot)); \
+			do j--; while (less_fn(pivot, data[j])); \
+			if (i >= j) break; \
+\
+			name##_swap(&data[i], &data[j]); \
+		} \
+\
+		name##_swap(&data[0], &data[j]); \
+\
+		/*Recurse into the smaller side, loop on the larger one*/ \
+		if (j < count - j - 1) \
+		{ \
+			name##_introsort(data, j, depth); \
+			data += j + 1; \
+			count -= j + 1; \
+		} \
+		else \
+		{ \
+			name##_introsort(&data[j + 1], count - j - 1, depth); \
+			count = j; \
+		} \
+	} \
+\
+	name##_insertion_sort(data, count); \
+} \
+\
+/*Equal elements may end up in any order*/ \
+static inline int name##_sort(name##_t *vec) \
+{ \
+	if (!vec) return SUS_INVALID_ARG; \
+\
+	size_t depth = 0; \
+	for (size_t n = vec->count; n > 1; n >>= 1) \
+		depth += 2; \
+\
+	name##_introsort(vec->data, vec->count, depth); \
+	return SUS_SUCCESS; \
+} \
+\
+/*First element not below value on a sorted vector, branchless like ivector_lower_bound*/ \
+static inline size_t name##_lower_bound(const name##_t *vec, T value) \
+{ \
+	size_t base = 0, count = vec->count; \
+	if (!count) return 0; \
+\
+	while (count > 1) \
+	{ \
+		size_t half = count / 2; \
+		base = less_fn(vec->data[base + half], value) ? base + half : base; \
+		count -= half; \
+	} \
+\
+	return base + (less_fn(vec->data[base], value) ? 1 : 0); \
+} \
+\
+/*SUS_TRUE if value is present in a sorted vector, index gets the first match or where value would be inserted*/ \
+static inline int name##_binary_search(const name##_t *vec, T value, size_t *index) \
+{ \
+	size_t i = name##_lower_bound(vec, value); \
+	if (index) *index = i; \
+\
+	return i < vec->count && eq_fn(vec->data[i], value) ? SUS_TRUE : SUS_FALSE; \
+}
+
+#endif
@@ -3,16 +3,49 @@
 
 #include <stddef.h>
 
+#include "ivector.h"
+
 #define VECTOR_DEFAULT_CAP 4
+//Vectors at least this long are sorted on every CPU
+#define VECTOR_SORT_PARALLEL_MIN 65536
+
+//data belongs to the caller, the vector moves to the heap instead of growing it and never frees it
+#define VECTOR_FLAG_BORROWED 0x1
+//data is a private anonymous mapping, grown and shrunk with mremap
+#define VECTOR_FLAG_MAPPED 0x2
+//Growth policy, set with vector_set_growth, doubling by default
+//Ask for transparent huge pages whenever the storage gets mapped
+#define VECTOR_FLAG_HUGE_PAGES 0x4
+//Grow by half the capacity instead of doubling
+#define VECTOR_FLAG_GROW_HALF 0x8
+//Once the storage reaches VECTOR_GROW_STEP bytes, grow in whole steps of that size
+#define VECTOR_FLAG_GROW_STEP 0x10
+#define VECTOR_GROWTH_FLAGS (VECTOR_FLAG_HUGE_PAGES | VECTOR_FLAG_GROW_HALF | VECTOR_FLAG_GROW_STEP)
+
+//Storage of at least this many bytes is mapped directly, so growing it moves pages instead of copying them
+#define VECTOR_MAP_MIN ((size_t)32 << 20)
+#define VECTOR_GROW_STEP ((size_t)256 << 20)
 
 typedef struct
 {
 	void **data;
 	size_t capacity;
 	size_t count;
+	int flags;
 } vector_t;
 
+//A vector whose first n elements live in the struct itself, set up with vector_init_small
+//The struct must not be copied or moved while the vector still uses buf
+#define VECTOR_SMALL(n) struct { vector_t vec; void *buf[n]; }
+#define vector_init_small(small) vector_init_buffer(&(small)->vec, (small)->buf, sizeof((small)->buf) / sizeof(void *))
+
 vector_t *vector_create();
+//In place setup for vectors on the stack or embedded in other structs, nothing is allocated until the first growth
+int vector_init(vector_t *vec);
+//Starts on capacity pointers of caller owned storage, spills to the heap once more are needed
+int vector_init_buffer(vector_t *vec, void **buf, size_t capacity);
+//Frees whatever heap storage an initialized vector picked up and leaves it empty
+int vector_deinit(vector_t *vec);
 int vector_destroy(vector_t *vec);
 int vector_destroy_free(vector_t *vec, void (*freer)(void *));
 vector_t *vector_duplicate(vector_t *vec);
@@ -20,6 +53,8 @@ vector_t *vector_from_range(vector_t *vec, size_t start, size_t count);
 
 int vector_ensure(vector_t *vec, size_t capacity);
 int vector_trim(vector_t *vec);
+//flags is any combination of the growth flags, replaces the previous policy
+int vector_set_growth(vector_t *vec, int flags);
 
 int vector_append(vector_t *vec, void *data);
 int vector_append_vector(vector_t *vec, vector_t *src);
@@ -30,12 +65,51 @@ int vector_pop_back(vector_t *vec);
 int vector_insert_at(vector_t *vec, void *data, size_t index);
 int vector_remove_at(vector_t *vec, size_t index);
 int vector_remove_range(vector_t *vec, size_t start, size_t count);
+//Insert count elements of src starting at start before index, the tail is shifted once, src may be vec
+int vector_insert_range_at(vector_t *vec, vector_t *src, size_t start, size_t count, size_t index);
+int vector_insert_vector_at(vector_t *vec, vector_t *src, size_t index);
+//indices must be strictly ascending, every kept element moves at most once
+int vector_remove_indices(vector_t *vec, const size_t *indices, size_t count);
 int vector_clear(vector_t *vec);
 
 int vector_iterate(vector_t *vec, void (*func)(void *));
 vector_t *vector_get_all(vector_t *vec, int (*match)(void *, void *), void *arg);
+//Appends the matches to out instead of allocating a new vector
+int vector_get_all_into(vector_t *vec, int (*match)(void *, void *), void *arg, vector_t *out);
+//Both keep the order of the remaining elements and run in a single pass
 size_t vector_remove(vector_t *vec, void *data);
 size_t vector_remove_all(vector_t *vec, int (*match)(void *, void *), void *arg);
+//Parallel versions run chunks of grain elements (0 for PARALLEL_DEFAULT_GRAIN) on the pool from parallel.h
+//Callbacks run concurrently and get arg as their last parameter
+int vector_parallel_iterate(vector_t *vec, void (*func)(void *, void *), void *arg, size_t grain);
+//Appends the matches to out in their original order, match is called once per element
+int vector_parallel_filter(vector_t *vec, int (*match)(void *, void *), void *arg, vector_t *out, size_t grain);
+//Appends one element of out->element_size per element, func(elem, result, arg) fills result in place
+int vector_parallel_map(vector_t *vec, void (*func)(void *, void *, void *), void *arg, ivector_t *out, size_t grain);
+//acc holds acc_size bytes and must start as the identity of combine, every chunk folds into its own copy of it
+//fold(acc, elem, arg) adds an element, combine(acc, other, arg) merges chunk results into acc in chunk order
+int vector_parallel_reduce(vector_t *vec, void (*fold)(void *, void *, void *), void (*combine)(void *, void *, void *), void *acc, size_t acc_size, void *arg, size_t grain);
+//Introsort, equal elements may end up in any order
 vector_t *vector_sort(vector_t *vec, int (*comparer)(void *, void *));
+//Merge sort, keeps equal elements in their original order, needs count pointers of scratch memory (NULL if unavailable)
+vector_t *vector_sort_stable(vector_t *vec, int (*comparer)(void *, void *));
+
+//Sorted vectors, comparer(elem, key) must order them the way they were sorted
+size_t vector_lower_bound(vector_t *vec, void *key, int (*comparer)(void *, void *));
+size_t vector_upper_bound(vector_t *vec, void *key, int (*comparer)(void *, void *));
+//SUS_TRUE if key is present, index gets the first match or where key would be inserted
+int vector_binary_search(vector_t *vec, void *key, int (*comparer)(void *, void *), size_t *index);
+//Inserts after any equal elements
+int vector_insert_sorted(vector_t *vec, void *data, int (*comparer)(void *, void *));
+//Leaves the vector alone if an equal element is present, inserted tells which happened
+int vector_insert_sorted_unique(vector_t *vec, void *data, int (*comparer)(void *, void *), int *inserted);
+//Keeps the first of every run of equal elements, returns how many were removed
+size_t vector_unique(vector_t *vec, int (*comparer)(void *, void *));
+//Append to out, which must be neither a nor b, equal elements pair up one to one and are taken from a
+int vector_set_union(vector_t *a, vector_t *b, int (*comparer)(void *, void *), vector_t *out);
+int vector_set_intersect(vector_t *a, vector_t *b, int (*comparer)(void *, void *), vector_t *out);
+int vector_set_difference(vector_t *a, vector_t *b, int (*comparer)(void *, void *), vector_t *out);
+//Appends the stable merge of count sorted vectors to out through a heap of their heads
+int vector_merge_sorted(vector_t **srcs, size_t count, int (*comparer)(void *, void *), vector_t *out);
 
 #endif
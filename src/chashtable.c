@@ -0,0 +1,534 @@
+#include "chashtable.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "sus.h"
+#include "fmix.h"
+
+
+
+//Stripe of a hash is its bucket index modulo the stripe count, so it is the same in any bucket array
+#define CHASHTABLE_STRIPES 64
+#define CHASHTABLE_READER_SLOTS 64
+#define CHASHTABLE_DEFAULT_CAP 256
+//Retired objects a stripe holds before it tries to reclaim them
+#define CHASHTABLE_RECLAIM_BATCH 64
+#define CHASHTABLE_CACHE_LINE 64
+
+typedef struct chashtable_garbage_t chashtable_garbage_t;
+typedef struct chashtable_entry_t chashtable_entry_t;
+typedef struct chashtable_buckets_t chashtable_buckets_t;
+
+//Object waiting for every reader that may have seen it to leave
+struct chashtable_garbage_t
+{
+	chashtable_garbage_t *next;
+	uint64_t epoch;
+	void (*freer)(void *);
+	void *ptr;
+	int detached; //Record was allocated on its own and must be freed too
+};
+
+struct chashtable_entry_t
+{
+	_Atomic(chashtable_entry_t *) next;
+	void *content;
+	void *key;
+	size_t hash;
+	chashtable_garbage_t garbage;
+};
+
+struct chashtable_buckets_t
+{
+	chashtable_garbage_t garbage;
+	size_t capacity;
+	//Set once migration into a bigger array starts
+	_Atomic(chashtable_buckets_t *) next;
+	size_t migrate_index;
+	_Atomic(chashtable_entry_t *) heads[];
+};
+
+typedef struct
+{
+	_Alignas(CHASHTABLE_CACHE_LINE) pthread_mutex_t lock;
+	atomic_size_t count;
+	chashtable_garbage_t *limbo;
+	size_t limbo_count;
+} chashtable_stripe_t;
+
+//Readers inside epoch e are counted in active[e & 1]
+typedef struct
+{
+	_Alignas(CHASHTABLE_CACHE_LINE) atomic_size_t active[2];
+} chashtable_reader_t;
+
+struct chashtable_t
+{
+	_Atomic(chashtable_buckets_t *) buckets;
+	chashtable_stripe_t *stripes;
+	chashtable_reader_t *readers;
+	_Atomic uint64_t epoch;
+	atomic_int resizing;
+	size_t (*hasher)(void*);
+	int (*comparer)(void*, void*);
+};
+
+
+
+//Stored in the head of an old bucket once its entries live in the next array
+static chashtable_entry_t chashtable_moved;
+
+static atomic_uint chashtable_next_slot;
+static _Thread_local unsigned chashtable_slot = ~0u;
+
+static chashtable_reader_t *chashtable_enter(chashtable_t *table, uint64_t *epoch)
+{
+	if (chashtable_slot == ~0u)
+		chashtable_slot = atomic_fetch_add(&chashtable_next_slot, 1) % CHASHTABLE_READER_SLOTS;
+
+	chashtable_reader_t *reader = &table->readers[chashtable_slot];
+	uint64_t current = atomic_load(&table->epoch);
+
+	//Retry if the epoch moved before we were counted, otherwise a reclaimer may have missed us
+	for (;;)
+	{
+		atomic_fetch_add(&reader->active[current & 1], 1);
+
+		uint64_t now = atomic_load(&table->epoch);
+		if (now == current) break;
+
+		atomic_fetch_sub(&reader->active[current & 1], 1);
+		current = now;
+	}
+
+	*epoch = current;
+	return reader;
+}
+
+static inline void chashtable_leave(chashtable_reader_t *reader, uint64_t epoch)
+{
+	atomic_fetch_sub_explicit(&reader->active[epoch & 1], 1, memory_order_release);
+}
+
+//Epoch can move to e+1 once nobody is left in e-1, garbage retired in e is safe from e+2 onwards
+static void chashtable_try_advance(chashtable_t *table)
+{
+	uint64_t epoch = atomic_load(&table->epoch);
+
+	for (size_t i = 0; i < CHASHTABLE_READER_SLOTS; i++)
+		if (atomic_load(&table->readers[i].active[(epoch - 1) & 1]))
+			return;
+
+	atomic_compare_exchange_strong(&table->epoch, &epoch, epoch + 1);
+}
+
+static void chashtable_free_garbage(chashtable_garbage_t *garbage)
+{
+	chashtable_garbage_t *next;
+
+	while (garbage)
+	{
+		next = garbage->next;
+		int detached = garbage->detached;
+		garbage->freer(garbage->ptr);
+		if (detached) free(garbage);
+		garbage = next;
+	}
+}
+
+//Stripe lock must be held
+static void chashtable_retire_locked(chashtable_t *table, chashtable_stripe_t *stripe, chashtable_garbage_t *garbage)
+{
+	garbage->epoch = atomic_load(&table->epoch);
+	garbage->next = stripe->limbo;
+	stripe->limbo = garbage;
+	stripe->limbo_count++;
+
+	if (stripe->limbo_count < CHASHTABLE_RECLAIM_BATCH)
+		return;
+
+	chashtable_try_advance(table);
+	uint64_t epoch = atomic_load(&table->epoch);
+
+	//Limbo is ordered newest first, everything past the first old enough record can go
+	chashtable_garbage_t **link = &stripe->limbo;
+	while (*link && (*link)->epoch + 2 > epoch)
+		link = &(*link)->next;
+
+	chashtable_garbage_t *expired = *link;
+	*link = NULL;
+
+	for (chashtable_garbage_t *tmp = expired; tmp; tmp = tmp->next)
+		stripe->limbo_count--;
+
+	chashtable_free_garbage(expired);
+}
+
+static void chashtable_retire_entry(chashtable_t *table, chashtable_stripe_t *stripe, chashtable_entry_t *entry)
+{
+	entry->garbage.ptr = entry;
+	entry->garbage.freer = free;
+	entry->garbage.detached = 0;
+	chashtable_retire_locked(table, stripe, &entry->garbage);
+}
+
+static chashtable_buckets_t *chashtable_alloc_buckets(size_t capacity)
+{
+	chashtable_buckets_t *buckets = malloc(sizeof(chashtable_buckets_t) + capacity * sizeof(_Atomic(chashtable_entry_t *)));
+	if (!buckets) return NULL;
+
+	buckets->capacity = capacity;
+	buckets->migrate_index = 0;
+	atomic_init(&buckets->next, NULL);
+
+	for (size_t i = 0; i < capacity; i++)
+		atomic_init(&buckets->heads[i], NULL);
+
+	return buckets;
+}
+
+//Readers must be inside an epoch, returns the entry holding key or NULL
+static chashtable_entry_t *chashtable_find(chashtable_t *table, void *key, size_t hash)
+{
+	chashtable_buckets_t *buckets = atomic_load_explicit(&table->buckets, memory_order_acquire);
+	chashtable_entry_t *entry;
+
+	while ((entry = atomic_load_explicit(&buckets->heads[hash & (buckets->capacity - 1)], memory_order_acquire)) == &chashtable_moved)
+		buckets = atomic_load_explicit(&buckets->next, memory_order_acquire);
+
+	for (; entry; entry = atomic_load_explicit(&entry->next, memory_order_acquire))
+		if (entry->hash == hash && !table->comparer(key, entry->key))
+			return entry;
+
+	return NULL;
+}
+
+//Stripe lock must be held, returns the head of the bucket hash currently lives in
+static _Atomic(chashtable_entry_t *) *chashtable_writer_head(chashtable_t *table, size_t hash, size_t *capacity)
+{
+	chashtable_buckets_t *buckets = atomic_load_explicit(&table->buckets, memory_order_acquire);
+	_Atomic(chashtable_entry_t *) *head;
+
+	while (atomic_load_explicit(head = &buckets->heads[hash & (buckets->capacity - 1)], memory_order_relaxed) == &chashtable_moved)
+		buckets = atomic_load_explicit(&buckets->next, memory_order_acquire);
+
+	*capacity = buckets->capacity;
+	return head;
+}
+
+//Copies one old bucket into the next array, old entries are retired since readers may still walk them
+static int chashtable_migrate_bucket(chashtable_t *table, chashtable_buckets_t *old, chashtable_buckets_t *new, size_t index)
+{
+	chashtable_stripe_t *stripe = &table->stripes[index & (CHASHTABLE_STRIPES - 1)];
+	pthread_mutex_lock(&stripe->lock);
+
+	chashtable_entry_t *chain = atomic_load_explicit(&old->heads[index], memory_order_relaxed);
+	chashtable_entry_t *copies = NULL, *copy, *entry;
+
+	for (entry = chain; entry; entry = atomic_load_explicit(&entry->next, memory_order_relaxed))
+	{
+		copy = malloc(sizeof(chashtable_entry_t));
+		if (!copy)
+		{
+			while (copies)
+			{
+				copy = copies;
+				copies = atomic_load_explicit(&copies->next, memory_order_relaxed);
+				free(copy);
+			}
+			pthread_mutex_unlock(&stripe->lock);
+			return SUS_FAILED_ALLOC;
+		}
+
+		copy->key = entry->key;
+		copy->content = entry->content;
+		copy->hash = entry->hash;
+		atomic_init(&copy->next, copies);
+		copies = copy;
+	}
+
+	//New buckets fed by this one are unreachable until the moved marker is published
+	while (copies)
+	{
+		copy = copies;
+		copies = atomic_load_explicit(&copies->next, memory_order_relaxed);
+
+		_Atomic(chashtable_entry_t *) *head = &new->heads[copy->hash & (new->capacity - 1)];
+		atomic_store_explicit(&copy->next, atomic_load_explicit(head, memory_order_relaxed), memory_order_relaxed);
+		atomic_store_explicit(head, copy, memory_order_relaxed);
+	}
+
+	atomic_store_explicit(&old->heads[index], &chashtable_moved, memory_order_release);
+
+	while (chain)
+	{
+		entry = chain;
+		chain = atomic_load_explicit(&chain->next, memory_order_relaxed);
+		chashtable_retire_entry(table, stripe, entry);
+	}
+
+	pthread_mutex_unlock(&stripe->lock);
+	return SUS_SUCCESS;
+}
+
+//Only one thread resizes at a time, everyone else keeps reading and writing meanwhile
+static void chashtable_grow(chashtable_t *table, size_t seen_capacity)
+{
+	int expected = 0;
+	if (!atomic_compare_exchange_strong(&table->resizing, &expected, 1))
+		return;
+
+	chashtable_buckets_t *old = atomic_load(&table->buckets);
+	chashtable_buckets_t *new = atomic_load(&old->next);
+
+	//Someone already grew past what the caller saw, unless a previous attempt was left halfway
+	if (old->capacity != seen_capacity && !new)
+		goto _chashtable_grow_done;
+
+	if (!new)
+	{
+		new = chashtable_alloc_buckets(old->capacity << 1);
+		if (!new) goto _chashtable_grow_done;
+		atomic_store(&old->next, new);
+	}
+
+	for (; old->migrate_index < old->capacity; old->migrate_index++)
+		if (chashtable_migrate_bucket(table, old, new, old->migrate_index))
+			goto _chashtable_grow_done; //Resumed by the next grow
+
+	atomic_store(&table->buckets, new);
+
+	chashtable_stripe_t *stripe = &table->stripes[0];
+	pthread_mutex_lock(&stripe->lock);
+	old->garbage.ptr = old;
+	old->garbage.freer = free;
+	old->garbage.detached = 0;
+	chashtable_retire_locked(table, stripe, &old->garbage);
+	pthread_mutex_unlock(&stripe->lock);
+
+_chashtable_grow_done:
+	atomic_store(&table->resizing, 0);
+}
+
+chashtable_t *chashtable_create(size_t (*hasher)(void*), int (*comparer)(void*, void*))
+{
+	if (!hasher) return NULL;
+	if (!comparer) return NULL;
+
+	chashtable_t *table = malloc(sizeof(chashtable_t));
+	if (!table) return NULL;
+
+	table->stripes = aligned_alloc(CHASHTABLE_CACHE_LINE, CHASHTABLE_STRIPES * sizeof(chashtable_stripe_t));
+	if (!table->stripes) { free(table); return NULL; }
+
+	table->readers = aligned_alloc(CHASHTABLE_CACHE_LINE, CHASHTABLE_READER_SLOTS * sizeof(chashtable_reader_t));
+	if (!table->readers) { free(table->stripes); free(table); return NULL; }
+
+	chashtable_buckets_t *buckets = chashtable_alloc_buckets(CHASHTABLE_DEFAULT_CAP);
+	if (!buckets) { free(table->readers); free(table->stripes); free(table); return NULL; }
+
+	for (size_t i = 0; i < CHASHTABLE_STRIPES; i++)
+	{
+		pthread_mutex_init(&table->stripes[i].lock, NULL);
+		atomic_init(&table->stripes[i].count, 0);
+		table->stripes[i].limbo = NULL;
+		table->stripes[i].limbo_count = 0;
+	}
+
+	for (size_t i = 0; i < CHASHTABLE_READER_SLOTS; i++)
+	{
+		atomic_init(&table->readers[i].active[0], 0);
+		atomic_init(&table->readers[i].active[1], 0);
+	}
+
+	atomic_init(&table->buckets, buckets);
+	atomic_init(&table->epoch, 0);
+	atomic_init(&table->resizing, 0);
+	table->hasher = hasher;
+	table->comparer = comparer;
+
+	return table;
+}
+
+int chashtable_destroy(chashtable_t *table)
+{
+	return chashtable_destroy_free(table, NULL, NULL);
+}
+
+int chashtable_destroy_free(chashtable_t *table, void (*free_key)(void *), void (*free_value)(void *))
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	chashtable_buckets_t *buckets = atomic_load(&table->buckets), *next;
+	chashtable_entry_t *entry, *tmp;
+
+	//A failed migration leaves a chain of arrays, live entries are wherever the moved markers lead
+	while (buckets)
+	{
+		for (size_t i = 0; i < buckets->capacity; i++)
+		{
+			entry = atomic_load(&buckets->heads[i]);
+			if (entry == &chashtable_moved) continue;
+
+			while (entry)
+			{
+				if (free_key) free_key(entry->key);
+				if (free_value) free_value(entry->content);
+				tmp = entry;
+				entry = atomic_load(&entry->next);
+				free(tmp);
+			}
+		}
+
+		next = atomic_load(&buckets->next);
+		free(buckets);
+		buckets = next;
+	}
+
+	for (size_t i = 0; i < CHASHTABLE_STRIPES; i++)
+	{
+		chashtable_free_garbage(table->stripes[i].limbo);
+		pthread_mutex_destroy(&table->stripes[i].lock);
+	}
+
+	free(table->stripes);
+	free(table->readers);
+	free(table);
+
+	return SUS_SUCCESS;
+}
+
+int chashtable_add(chashtable_t *table, void *key, void *value)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	size_t hash = (size_t)hash_fmix64(table->hasher(key)), capacity;
+
+	chashtable_entry_t *new_entry = malloc(sizeof(chashtable_entry_t));
+	if (!new_entry) return SUS_FAILED_ALLOC;
+
+	new_entry->content = value;
+	new_entry->key = key;
+	new_entry->hash = hash;
+
+	uint64_t epoch;
+	chashtable_reader_t *reader = chashtable_enter(table, &epoch);
+	chashtable_stripe_t *stripe = &table->stripes[hash & (CHASHTABLE_STRIPES - 1)];
+	pthread_mutex_lock(&stripe->lock);
+
+	_Atomic(chashtable_entry_t *) *head = chashtable_writer_head(table, hash, &capacity);
+	atomic_init(&new_entry->next, atomic_load_explicit(head, memory_order_relaxed));
+	atomic_store_explicit(head, new_entry, memory_order_release);
+	size_t stripe_count = atomic_fetch_add_explicit(&stripe->count, 1, memory_order_relaxed) + 1;
+
+	pthread_mutex_unlock(&stripe->lock);
+	chashtable_leave(reader, epoch);
+
+	//Estimated from this stripe alone to keep writers off a shared counter, grows past 75% fill
+	if (stripe_count * CHASHTABLE_STRIPES * 4 > capacity * 3)
+		chashtable_grow(table, capacity);
+
+	return SUS_SUCCESS;
+}
+
+void *chashtable_get(chashtable_t *table, void *key)
+{
+	if (!table) return NULL;
+
+	size_t hash = (size_t)hash_fmix64(table->hasher(key));
+	uint64_t epoch;
+	chashtable_reader_t *reader = chashtable_enter(table, &epoch);
+
+	chashtable_entry_t *entry = chashtable_find(table, key, hash);
+	void *ret = entry ? entry->content : NULL;
+
+	chashtable_leave(reader, epoch);
+	return ret;
+}
+
+int chashtable_remove(chashtable_t *table, void *key, void **removed_key, void **removed_content)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	size_t hash = (size_t)hash_fmix64(table->hasher(key)), capacity;
+	int ret = SUS_ENTRY_NOT_FOUND;
+
+	uint64_t epoch;
+	chashtable_reader_t *reader = chashtable_enter(table, &epoch);
+	chashtable_stripe_t *stripe = &table->stripes[hash & (CHASHTABLE_STRIPES - 1)];
+	pthread_mutex_lock(&stripe->lock);
+
+	_Atomic(chashtable_entry_t *) *link = chashtable_writer_head(table, hash, &capacity);
+	chashtable_entry_t *entry;
+
+	for (; (entry = atomic_load_explicit(link, memory_order_relaxed)); link = &entry->next)
+	{
+		if (entry->hash != hash || table->comparer(key, entry->key))
+			continue;
+
+		if (removed_key) *removed_key = entry->key;
+		if (removed_content) *removed_content = entry->content;
+
+		atomic_store(link, atomic_load_explicit(&entry->next, memory_order_relaxed));
+		atomic_fetch_sub_explicit(&stripe->count, 1, memory_order_relaxed);
+		chashtable_retire_entry(table, stripe, entry);
+		ret = SUS_SUCCESS;
+		break;
+	}
+
+	pthread_mutex_unlock(&stripe->lock);
+	chashtable_leave(reader, epoch);
+
+	return ret;
+}
+
+size_t chashtable_get_count(chashtable_t *table)
+{
+	if (!table)
+		return 0;
+
+	size_t count = 0;
+
+	for (size_t i = 0; i < CHASHTABLE_STRIPES; i++)
+		count += atomic_load_explicit(&table->stripes[i].count, memory_order_relaxed);
+
+	return count;
+}
+
+int chashtable_has_key(chashtable_t *table, void* key)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	size_t hash = (size_t)hash_fmix64(table->hasher(key));
+	uint64_t epoch;
+	chashtable_reader_t *reader = chashtable_enter(table, &epoch);
+
+	int ret = chashtable_find(table, key, hash) ? SUS_TRUE : SUS_FALSE;
+
+	chashtable_leave(reader, epoch);
+	return ret;
+}
+
+int chashtable_retire(chashtable_t *table, void *ptr, void (*freer)(void *))
+{
+	if (!table) return SUS_INVALID_ARG;
+	if (!freer) return SUS_INVALID_ARG;
+
+	chashtable_garbage_t *garbage = malloc(sizeof(chashtable_garbage_t));
+	if (!garbage) return SUS_FAILED_ALLOC;
+
+	garbage->ptr = ptr;
+	garbage->freer = freer;
+	garbage->detached = 1;
+
+	chashtable_stripe_t *stripe = &table->stripes[hash_fmix64((uintptr_t)ptr) & (CHASHTABLE_STRIPES - 1)];
+	pthread_mutex_lock(&stripe->lock);
+	chashtable_retire_locked(table, stripe, garbage);
+	pthread_mutex_unlock(&stripe->lock);
+
+	return SUS_SUCCESS;
+}
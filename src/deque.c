@@ -0,0 +1,255 @@
+#include "deque.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "sus.h"
+
+#define SLOT(deque, idx) (((deque)->head + (idx)) & ((deque)->capacity - 1))
+
+
+
+deque_t *deque_create()
+{
+	deque_t *ret = malloc(sizeof(deque_t));
+	if (!ret) return NULL;
+
+	ret->data = malloc(DEQUE_DEFAULT_CAP * sizeof(void *));
+	if (!ret->data) { free(ret); return NULL; }
+
+	ret->capacity = DEQUE_DEFAULT_CAP;
+	ret->head = 0;
+	ret->count = 0;
+
+	return ret;
+}
+
+int deque_destroy(deque_t *deque)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	free(deque->data);
+	free(deque);
+
+	return SUS_SUCCESS;
+}
+
+int deque_destroy_free(deque_t *deque, void (*freer)(void *))
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (!freer) return SUS_INVALID_ARG;
+
+	for (size_t i = 0; i < deque->count; i++)
+		freer(deque->data[SLOT(deque, i)]);
+
+	return deque_destroy(deque);
+}
+
+deque_t *deque_duplicate(deque_t *deque)
+{
+	if (!deque) return NULL;
+
+	deque_t *ret = deque_create();
+	if (!ret) return NULL;
+
+	if (deque_ensure(ret, deque->count))
+	{
+		deque_destroy(ret);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < deque->count; i++)
+		ret->data[i] = deque->data[SLOT(deque, i)];
+	ret->count = deque->count;
+
+	return ret;
+}
+
+//Moves the elements to a new buffer of capacity slots, unwrapped so head becomes 0
+static int deque_set_capacity(deque_t *deque, size_t capacity)
+{
+	void **tmp = malloc(capacity * sizeof(void *));
+	if (!tmp) return SUS_FAILED_ALLOC;
+
+	size_t first = deque->capacity - deque->head;
+	if (first > deque->count) first = deque->count;
+
+	memcpy(tmp, &deque->data[deque->head], first * sizeof(void *));
+	memcpy(&tmp[first], deque->data, (deque->count - first) * sizeof(void *));
+
+	free(deque->data);
+	deque->data = tmp;
+	deque->capacity = capacity;
+	deque->head = 0;
+
+	return SUS_SUCCESS;
+}
+
+int deque_ensure(deque_t *deque, size_t capacity)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (deque->capacity >= capacity) return SUS_SUCCESS;
+
+	size_t new_capacity = deque->capacity;
+	while (new_capacity < capacity) new_capacity <<= 1;
+
+	return deque_set_capacity(deque, new_capacity);
+}
+
+int deque_trim(deque_t *deque)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	//Capacity has to stay a power of two, so trim to the smallest one that fits
+	size_t capacity = DEQUE_DEFAULT_CAP;
+	while (capacity < deque->count) capacity <<= 1;
+	if (capacity == deque->capacity) return SUS_SUCCESS;
+
+	return deque_set_capacity(deque, capacity);
+}
+
+int deque_push_back(deque_t *deque, void *data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	int err = deque_ensure(deque, deque->count + 1);
+	if (err) return err;
+
+	deque->data[SLOT(deque, deque->count)] = data;
+	deque->count++;
+	return SUS_SUCCESS;
+}
+
+int deque_push_front(deque_t *deque, void *data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	int err = deque_ensure(deque, deque->count + 1);
+	if (err) return err;
+
+	deque->head = (deque->head - 1) & (deque->capacity - 1);
+	deque->data[deque->head] = data;
+	deque->count++;
+	return SUS_SUCCESS;
+}
+
+int deque_pop_back(deque_t *deque, void **data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	if (!deque->count)
+		return SUS_INVALID_INDEX;
+
+	deque->count--;
+	if (data) *data = deque->data[SLOT(deque, deque->count)];
+	return SUS_SUCCESS;
+}
+
+int deque_pop_front(deque_t *deque, void **data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	if (!deque->count)
+		return SUS_INVALID_INDEX;
+
+	if (data) *data = deque->data[deque->head];
+	deque->head = SLOT(deque, 1);
+	deque->count--;
+	return SUS_SUCCESS;
+}
+
+int deque_insert_at(deque_t *deque, void *data, size_t index)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (index > deque->count) return SUS_INVALID_INDEX;
+
+	int err = deque_ensure(deque, deque->count + 1);
+	if (err) return err;
+
+	if (index < deque->count / 2)
+	{
+		deque->head = (deque->head - 1) & (deque->capacity - 1);
+		for (size_t i = 0; i < index; i++)
+			deque->data[SLOT(deque, i)] = deque->data[SLOT(deque, i + 1)];
+	}
+	else
+	{
+		for (size_t i = deque->count; i > index; i--)
+			deque->data[SLOT(deque, i)] = deque->data[SLOT(deque, i - 1)];
+	}
+
+	deque->data[SLOT(deque, index)] = data;
+	deque->count++;
+	return SUS_SUCCESS;
+}
+
+int deque_remove_at(deque_t *deque, size_t index)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	if (index >= deque->count)
+		return SUS_INVALID_INDEX;
+
+	if (index < deque->count / 2)
+	{
+		for (size_t i = index; i > 0; i--)
+			deque->data[SLOT(deque, i)] = deque->data[SLOT(deque, i - 1)];
+		deque->head = SLOT(deque, 1);
+	}
+	else
+	{
+		for (size_t i = index; i + 1 < deque->count; i++)
+			deque->data[SLOT(deque, i)] = deque->data[SLOT(deque, i + 1)];
+	}
+
+	deque->count--;
+	return SUS_SUCCESS;
+}
+
+int deque_clear(deque_t *deque)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	deque->head = 0;
+	deque->count = 0;
+	return SUS_SUCCESS;
+}
+
+void *deque_get(deque_t *deque, size_t index)
+{
+	if (!deque) return NULL;
+	if (index >= deque->count) return NULL;
+
+	return deque->data[SLOT(deque, index)];
+}
+
+int deque_set(deque_t *deque, size_t index, void *data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (index >= deque->count) return SUS_INVALID_INDEX;
+
+	deque->data[SLOT(deque, index)] = data;
+	return SUS_SUCCESS;
+}
+
+void *deque_front(deque_t *deque)
+{
+	return deque_get(deque, 0);
+}
+
+void *deque_back(deque_t *deque)
+{
+	if (!deque || !deque->count) return NULL;
+
+	return deque->data[SLOT(deque, deque->count - 1)];
+}
+
+int deque_iterate(deque_t *deque, void (*func)(void *))
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (!func) return SUS_INVALID_ARG;
+
+	for (size_t i = 0; i < deque->count; i++)
+		func(deque->data[SLOT(deque, i)]);
+
+	return SUS_SUCCESS;
+}
@@ -0,0 +1,19 @@
+#ifndef SUS_FMIX_H_
+#define SUS_FMIX_H_
+
+#include <stdint.h>
+
+//Internal bit mixer shared by the hashers and the tables, not installed
+
+//Full murmur3 64 bit finalizer, every input bit affects every output bit
+static inline uint64_t hash_fmix64(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+#endif
@@ -1,16 +1,140 @@
 #include "hashes.h"
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
-size_t hash_str(void *ptr)
+#include "fmix.h"
+
+
+
+//wyhash style constants, odd with balanced bit counts
+static const uint64_t hash_secret[4] = { 0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL };
+static uint64_t hash_seed = 0;
+
+//Full 64x64 -> 128 bit multiply, low half in a and high half in b
+static inline void hash_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 r = *a;
+	r *= *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32), c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t hash_mix(uint64_t a, uint64_t b)
 {
-	char *str = ptr;
-	size_t hash = *str;
+	hash_mum(&a, &b);
+	return a ^ b;
+}
 
-	while (*(++str)) hash = hash * 41 + *str;
+static inline uint64_t hash_read64(const uint8_t *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
 
-	return hash;
+static inline uint64_t hash_read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+//1 to 3 bytes, reads first, middle and last which may overlap
+static inline uint64_t hash_read_small(const uint8_t *p, size_t len)
+{
+	return ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+}
+
+void hash_set_seed(uint64_t seed)
+{
+	hash_seed = seed;
+}
+
+uint64_t hash_mem_seed(const void *ptr, size_t len, uint64_t seed)
+{
+	const uint8_t *p = ptr;
+	uint64_t a, b;
+
+	seed ^= hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+
+	if (len <= 16)
+	{
+		if (len >= 4)
+		{
+			//Two possibly overlapping 4 byte reads from each end cover 4 to 16 bytes
+			size_t mid = (len >> 3) << 2;
+			a = (hash_read32(p) << 32) | hash_read32(p + mid);
+			b = (hash_read32(p + len - 4) << 32) | hash_read32(p + len - 4 - mid);
+		}
+		else if (len)
+		{
+			a = hash_read_small(p, len);
+			b = 0;
+		}
+		else
+		{
+			a = b = 0;
+		}
+	}
+	else
+	{
+		size_t left = len;
+
+		//Three independent lanes of 16 bytes keep the multipliers busy on long keys
+		if (left > 48)
+		{
+			uint64_t seed1 = seed, seed2 = seed;
+
+			do
+			{
+				seed = hash_mix(hash_read64(p) ^ hash_secret[1], hash_read64(p + 8) ^ seed);
+				seed1 = hash_mix(hash_read64(p + 16) ^ hash_secret[2], hash_read64(p + 24) ^ seed1);
+				seed2 = hash_mix(hash_read64(p + 32) ^ hash_secret[3], hash_read64(p + 40) ^ seed2);
+				p += 48;
+				left -= 48;
+			} while (left > 48);
+
+			seed ^= seed1 ^ seed2;
+		}
+
+		while (left > 16)
+		{
+			seed = hash_mix(hash_read64(p) ^ hash_secret[1], hash_read64(p + 8) ^ seed);
+			p += 16;
+			left -= 16;
+		}
+
+		a = hash_read64(p + left - 16);
+		b = hash_read64(p + left - 8);
+	}
+
+	a ^= hash_secret[1];
+	b ^= seed;
+	hash_mum(&a, &b);
+
+	return hash_mix(a ^ hash_secret[0] ^ len, b ^ hash_secret[1]);
+}
+
+size_t hash_mem(const void *ptr, size_t len)
+{
+	return (size_t)hash_mem_seed(ptr, len, hash_seed);
+}
+
+size_t hash_str(void *ptr)
+{
+	return hash_mem(ptr, strlen(ptr));
 }
 int compare_str(void *ptr1, void *ptr2)
 {
@@ -18,9 +142,45 @@ int compare_str(void *ptr1, void *ptr2)
 }
 size_t hash_ptr(void *ptr)
 {
-	return (size_t)ptr;
+	return (size_t)hash_fmix64((uintptr_t)ptr);
 }
 int compare_ptr(void *ptr1, void *ptr2)
 {
 	return ptr1 == ptr2 ? 0 : (ptr1 > ptr2 ? 1 : -1);
 }
+size_t hash_u32(void *ptr)
+{
+	return (size_t)hash_fmix64((uint32_t)(uintptr_t)ptr);
+}
+int compare_u32(void *ptr1, void *ptr2)
+{
+	uint32_t a = (uint32_t)(uintptr_t)ptr1, b = (uint32_t)(uintptr_t)ptr2;
+	return a == b ? 0 : (a > b ? 1 : -1);
+}
+size_t hash_u64(void *ptr)
+{
+	return (size_t)hash_fmix64((uintptr_t)ptr);
+}
+int compare_u64(void *ptr1, void *ptr2)
+{
+	uint64_t a = (uintptr_t)ptr1, b = (uintptr_t)ptr2;
+	return a == b ? 0 : (a > b ? 1 : -1);
+}
+size_t hash_u32_ref(void *ptr)
+{
+	return (size_t)hash_fmix64(*(uint32_t *)ptr);
+}
+int compare_u32_ref(void *ptr1, void *ptr2)
+{
+	uint32_t a = *(uint32_t *)ptr1, b = *(uint32_t *)ptr2;
+	return a == b ? 0 : (a > b ? 1 : -1);
+}
+size_t hash_u64_ref(void *ptr)
+{
+	return (size_t)hash_fmix64(*(uint64_t *)ptr);
+}
+int compare_u64_ref(void *ptr1, void *ptr2)
+{
+	uint64_t a = *(uint64_t *)ptr1, b = *(uint64_t *)ptr2;
+	return a == b ? 0 : (a > b ? 1 : -1);
+}
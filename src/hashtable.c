@@ -1,11 +1,16 @@
 #include "hashtable.h"
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "sus.h"
+#include "fmix.h"
 #include "vector.h"
+#include "math_utils.h"
+#include "mapped.h"
 
 
 
@@ -16,15 +21,61 @@ struct hashtable_entry_t
 	hashtable_entry_t *next;
 	void *content;
 	void *key;
+	//Full hasher output, checked before the comparer and reused when relinking
+	size_t hash;
 };
 
+//Entries are carved out of slabs, slab sizes double from MIN up to MAX entries
+#define HASHTABLE_SLAB_MIN 64
+#define HASHTABLE_SLAB_MAX 8192
+#define HASHTABLE_SLAB_ALIGN 64
+
+typedef struct hashtable_slab_t hashtable_slab_t;
+
+struct hashtable_slab_t
+{
+	hashtable_slab_t *next;
+	size_t capacity;
+	_Alignas(HASHTABLE_SLAB_ALIGN) hashtable_entry_t entries[];
+};
+
+#ifdef SUS_HASHTABLE_STATS
+typedef struct
+{
+	size_t lookups;
+	size_t comparer_calls;
+	size_t resizes;
+	uint64_t resize_ns;
+	uint64_t max_resize_ns;
+} hashtable_counters_t;
+#endif
+
 struct hashtable_t
 {
 	hashtable_entry_t **entries;
 	size_t capacity;
 	size_t count;
+	//Buckets not yet moved by an incremental resize, NULL when none is in progress
+	hashtable_entry_t **old_entries;
+	size_t old_capacity;
+	size_t migrate_index;
+	//Old buckets below it have had their pages released
+	size_t release_index;
+	//Entry pool, freed entries are linked through next
+	hashtable_slab_t *slabs;
+	size_t slab_used;
+	hashtable_entry_t *free_entries;
+	int flags;
+	//Grows above grow_at entries, shrinks below shrink_at but never under min_capacity buckets
+	double max_load;
+	size_t grow_at;
+	size_t shrink_at;
+	size_t min_capacity;
 	size_t (*hasher)(void*);
 	int (*comparer)(void*, void*);
+#ifdef SUS_HASHTABLE_STATS
+	hashtable_counters_t counters;
+#endif
 };
 
 
@@ -34,158 +85,575 @@ struct hashtable_t
 //If you reach this limit, the code still handles it but you should reconsider your life
 #define HASHTABLE_SIZE_COUNT 12
 static const size_t hashtable_sizes[HASHTABLE_SIZE_COUNT] = { 67, 257, 1031, 4099, 16411, 65537, 262147, 1048583, 4194319, 16777259, 67108879, 268435459 };
-#define HASHTABLE_DEFAULT_CAP (hashtable_sizes[0])
+#define HASHTABLE_DEFAULT_POW2_CAP 64
+//Keys looked up together by the batched lookups
+#define HASHTABLE_BATCH 16
+//Migrated old buckets are released in runs of this many bytes, so freeing the old array at the end has next to nothing left to unmap
+#define HASHTABLE_RELEASE_BYTES (1 << 20)
+
+//Maps a hash to a bucket, capacity must be a power of two in pow2 mode
+static inline size_t hashtable_bucket(const hashtable_t *table, size_t hash, size_t capacity)
+{
+	if (!(table->flags & HASHTABLE_FLAG_POW2))
+		return hash % capacity;
+
+	//Masking only keeps the low bits, weak hashers (eg: aligned pointers) need every bit mixed into them
+	return (size_t)hash_fmix64(hash) & (capacity - 1);
+}
+
+//Counters only exist when built with SUS_HASHTABLE_STATS, everything below compiles away otherwise
+#ifdef SUS_HASHTABLE_STATS
+#define HASHTABLE_COUNT(table, field) ((table)->counters.field++)
+
+static inline uint64_t hashtable_clock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void hashtable_count_resize(hashtable_t *table, uint64_t start)
+{
+	uint64_t elapsed = hashtable_clock() - start;
+
+	table->counters.resizes++;
+	table->counters.resize_ns += elapsed;
+	table->counters.max_resize_ns = MAX(table->counters.max_resize_ns, elapsed);
+}
+
+//Incremental migration is part of a resize that was already counted, only its time is added
+static void hashtable_count_migration(hashtable_t *table, uint64_t start)
+{
+	uint64_t elapsed = hashtable_clock() - start;
+
+	table->counters.resize_ns += elapsed;
+	table->counters.max_resize_ns = MAX(table->counters.max_resize_ns, elapsed);
+}
+#else
+#define HASHTABLE_COUNT(table, field) ((void)0)
+
+static inline uint64_t hashtable_clock(void) { return 0; }
+static inline void hashtable_count_resize(hashtable_t *table, uint64_t start) { (void)table; (void)start; }
+static inline void hashtable_count_migration(hashtable_t *table, uint64_t start) { (void)table; (void)start; }
+#endif
+
+static inline int hashtable_compare(hashtable_t *table, void *key1, void *key2)
+{
+	HASHTABLE_COUNT(table, comparer_calls);
+	return table->comparer(key1, key2);
+}
+
+static hashtable_entry_t *hashtable_alloc_entry(hashtable_t *table)
+{
+	hashtable_entry_t *entry = table->free_entries;
+
+	if (entry)
+	{
+		table->free_entries = entry->next;
+		return entry;
+	}
+
+	if (!table->slabs || table->slab_used == table->slabs->capacity)
+	{
+		size_t capacity = table->slabs ? MIN(table->slabs->capacity << 1, HASHTABLE_SLAB_MAX) : HASHTABLE_SLAB_MIN;
+
+		hashtable_slab_t *slab = aligned_alloc(HASHTABLE_SLAB_ALIGN, sizeof(hashtable_slab_t) + capacity * sizeof(hashtable_entry_t));
+		if (!slab) return NULL;
+
+		slab->next = table->slabs;
+		slab->capacity = capacity;
+		table->slabs = slab;
+		table->slab_used = 0;
+	}
+
+	return &table->slabs->entries[table->slab_used++];
+}
+
+static inline void hashtable_free_entry(hashtable_t *table, hashtable_entry_t *entry)
+{
+	entry->next = table->free_entries;
+	table->free_entries = entry;
+}
+
+static void hashtable_relink(hashtable_t *table, hashtable_entry_t *entry)
+{
+	hashtable_entry_t *next;
+
+	while (entry)
+	{
+		next = entry->next;
+		size_t hash_index = hashtable_bucket(table, entry->hash, table->capacity);
+		entry->next = table->entries[hash_index];
+		table->entries[hash_index] = entry;
+		entry = next;
+	}
+}
+
+//Moves up to buckets old buckets into the current array, releasing the old array once done
+static void hashtable_migrate(hashtable_t *table, size_t buckets)
+{
+	if (!table->old_entries) return;
+
+	size_t end = table->old_capacity - table->migrate_index > buckets ? table->migrate_index + buckets : table->old_capacity;
+
+	for (; table->migrate_index < end; table->migrate_index++)
+		hashtable_relink(table, table->old_entries[table->migrate_index]);
+
+	if (table->migrate_index == table->old_capacity)
+	{
+		free(table->old_entries);
+		table->old_entries = NULL;
+		table->old_capacity = 0;
+		table->migrate_index = 0;
+		table->release_index = 0;
+	}
+	else if ((table->migrate_index - table->release_index) * sizeof(hashtable_entry_t*) >= HASHTABLE_RELEASE_BYTES)
+	{
+		mapped_release(&table->old_entries[table->release_index], (table->migrate_index - table->release_index) * sizeof(hashtable_entry_t*));
+		table->release_index = table->migrate_index;
+	}
+}
+
+//hashtable_migrate outside of a timed resize, so the time it takes still reaches resize_ns
+static void hashtable_migrate_timed(hashtable_t *table, size_t buckets)
+{
+	if (!table->old_entries) return;
+
+	uint64_t start = hashtable_clock();
+	hashtable_migrate(table, buckets);
+	hashtable_count_migration(table, start);
+}
+
+static void hashtable_update_limits(hashtable_t *table)
+{
+	double grow_at = table->capacity * table->max_load;
+	table->grow_at = grow_at < (double)SIZE_MAX ? (size_t)grow_at : SIZE_MAX;
+	table->shrink_at = table->grow_at >> 2;
+}
+
+static int hashtable_begin_migration(hashtable_t *table, size_t capacity)
+{
+	//Large arrays come zeroed from fresh pages, so starting an incremental resize does not touch every bucket
+	hashtable_entry_t **tmp = calloc(capacity, sizeof(hashtable_entry_t*));
+	if (!tmp) return SUS_FAILED_ALLOC;
+
+	table->old_entries = table->entries;
+	table->old_capacity = table->capacity;
+	table->migrate_index = 0;
+	table->release_index = 0;
+	table->entries = tmp;
+	table->capacity = capacity;
+	hashtable_update_limits(table);
+
+	return SUS_SUCCESS;
+}
+
+//Smallest bucket count of the table's size sequence that holds count entries under max_load
+//0 when that bucket array could not be allocated, a tiny max_load can ask for more buckets than size_t holds
+static size_t hashtable_fit_capacity(hashtable_t *table, size_t count)
+{
+	size_t max_capacity = SIZE_MAX / sizeof(hashtable_entry_t*);
+	double needed_buckets = count / table->max_load;
+	if (!(needed_buckets < (double)max_capacity)) return 0;
+
+	size_t needed = (size_t)needed_buckets + 1;
+	size_t capacity = 0;
+
+	if (table->flags & HASHTABLE_FLAG_POW2)
+	{
+		capacity = round_pow2(needed, HASHTABLE_DEFAULT_POW2_CAP);
+		return capacity <= max_capacity ? capacity : 0;
+	}
+
+	for (int i = 0; i < HASHTABLE_SIZE_COUNT; i++)
+	{
+		capacity = hashtable_sizes[i];
+		if (capacity >= needed) break;
+	}
+
+	while (capacity < needed)
+	{
+		if (capacity > max_capacity >> 2) return 0;
+		capacity <<= 2;
+	}
+
+	return capacity;
+}
+
+static int hashtable_set_capacity(hashtable_t *table, size_t capacity)
+{
+	if (!(table->flags & HASHTABLE_FLAG_INCREMENTAL))
+		return hashtable_resize(table, capacity);
+
+	hashtable_migrate_timed(table, SIZE_MAX);
+
+	uint64_t start = hashtable_clock();
+	int err = hashtable_begin_migration(table, capacity);
+	if (!err) hashtable_count_resize(table, start);
+
+	return err;
+}
 
 static int hashtable_grow(hashtable_t *table)
 {
 	size_t target_size = 0;
 
-	for (int i = 0; i < HASHTABLE_SIZE_COUNT; i++)
+	if (table->flags & HASHTABLE_FLAG_POW2)
 	{
-		target_size = hashtable_sizes[i];
-		if (target_size > table->capacity) break;
+		target_size = table->capacity << 1;
+	}
+	else
+	{
+		for (int i = 0; i < HASHTABLE_SIZE_COUNT; i++)
+		{
+			target_size = hashtable_sizes[i];
+			if (target_size > table->capacity) break;
+		}
 	}
 
 	while (target_size <= table->capacity) target_size <<= 2;
 
-	return hashtable_resize(table, target_size);
+	return hashtable_set_capacity(table, target_size);
 }
 
-hashtable_t *hashtable_create(size_t (*hasher)(void*), int (*comparer)(void*, void*))
+//Shrinks to half the max load, so a shrunk table is as far from growing again as from shrinking
+static int hashtable_shrink(hashtable_t *table)
 {
-	if (!hasher) return NULL;
-	if (!comparer) return NULL;
+	size_t target_size = hashtable_fit_capacity(table, table->count << 1);
+	if (!target_size) return SUS_SUCCESS;
 
-	hashtable_t *table = malloc(sizeof(hashtable_t));
-	if (!table) return NULL;
+	target_size = MAX(target_size, table->min_capacity);
+	if (target_size >= table->capacity)
+		return SUS_SUCCESS;
 
-	table->entries = malloc(sizeof(hashtable_entry_t*) * HASHTABLE_DEFAULT_CAP);
-	if (!table->entries) { free(table); return NULL; }
-	
-	memset(table->entries, 0, sizeof(hashtable_entry_t*) * HASHTABLE_DEFAULT_CAP);
+	return hashtable_set_capacity(table, target_size);
+}
 
-	table->capacity = HASHTABLE_DEFAULT_CAP;
-	table->count = 0;
-	table->hasher = hasher;
-	table->comparer = comparer;
+//Returns the link pointing to the entry holding key, or NULL if not found
+static hashtable_entry_t **hashtable_find(hashtable_t *table, void *key, size_t hash)
+{
+	hashtable_entry_t **link = &table->entries[hashtable_bucket(table, hash, table->capacity)];
 
-	return table;
+	for (; *link; link = &(*link)->next)
+		if ((*link)->hash == hash && !hashtable_compare(table, key, (*link)->key))
+			return link;
+
+	if (!table->old_entries) return NULL;
+
+	size_t old_index = hashtable_bucket(table, hash, table->old_capacity);
+	if (old_index < table->migrate_index) return NULL;
+
+	for (link = &table->old_entries[old_index]; *link; link = &(*link)->next)
+		if ((*link)->hash == hash && !hashtable_compare(table, key, (*link)->key))
+			return link;
+
+	return NULL;
 }
 
-int hashtable_destroy(hashtable_t *table)
+//Looks up count (at most HASHTABLE_BATCH) keys at once, walking all chains in lockstep so their misses overlap
+static void hashtable_find_batch(hashtable_t *table, void **keys, size_t count, hashtable_entry_t **found)
 {
-	if (!table) return SUS_INVALID_ARG;
+	size_t hashes[HASHTABLE_BATCH];
+	hashtable_entry_t **heads[HASHTABLE_BATCH];
+	hashtable_entry_t *cursors[HASHTABLE_BATCH];
 
-	hashtable_entry_t *entry, *tmp;
+	for (size_t i = 0; i < count; i++)
+	{
+		HASHTABLE_COUNT(table, lookups);
+		hashes[i] = table->hasher(keys[i]);
+		heads[i] = &table->entries[hashtable_bucket(table, hashes[i], table->capacity)];
+		__builtin_prefetch(heads[i]);
+	}
 
-	for (size_t i = 0; i < table->capacity; i++)
+	for (size_t i = 0; i < count; i++)
 	{
-		entry = table->entries[i];
-		
-		while (entry)
+		found[i] = NULL;
+		cursors[i] = *heads[i];
+		if (cursors[i]) __builtin_prefetch(cursors[i]);
+	}
+
+	for (size_t pending = count; pending; )
+	{
+		pending = 0;
+
+		for (size_t i = 0; i < count; i++)
 		{
-			tmp = entry;
-			entry = entry->next;
-			free(tmp);
+			hashtable_entry_t *entry = cursors[i];
+			if (!entry) continue;
+
+			if (entry->hash == hashes[i] && !hashtable_compare(table, keys[i], entry->key))
+			{
+				found[i] = entry;
+				cursors[i] = NULL;
+				continue;
+			}
+
+			cursors[i] = entry->next;
+			if (entry->next)
+			{
+				__builtin_prefetch(entry->next);
+				pending++;
+			}
 		}
 	}
 
-	free(table->entries);
-	free(table);
+	if (!table->old_entries) return;
 
-	return SUS_SUCCESS;
+	//Keys not found yet may still be waiting in a bucket that was not migrated
+	for (size_t i = 0; i < count; i++)
+	{
+		if (found[i]) continue;
+
+		hashtable_entry_t **link = hashtable_find(table, keys[i], hashes[i]);
+		found[i] = link ? *link : NULL;
+	}
 }
 
-int hashtable_destroy_free(hashtable_t *table, void (*free_key)(void *), void (*free_value)(void *))
+static void hashtable_free_chains(hashtable_entry_t **entries, size_t start, size_t end, void (*free_key)(void *), void (*free_value)(void *))
 {
-	if (!table) return SUS_INVALID_ARG;
+	hashtable_entry_t *entry;
 
-	hashtable_entry_t *entry, *tmp;
-	for (size_t i = 0; i < table->capacity; i++)
+	for (size_t i = start; i < end; i++)
 	{
-		entry = table->entries[i];
-		
-		while (entry)
+		for (entry = entries[i]; entry; entry = entry->next)
 		{
 			if (free_key) free_key(entry->key);
 			if (free_value) free_value(entry->content);
-			tmp = entry;
+		}
+	}
+}
+
+static void hashtable_collect(vector_t *ret, hashtable_entry_t **entries, size_t start, size_t end, int keys)
+{
+	for (size_t i = start; i < end; i++)
+	{
+		hashtable_entry_t *entry = entries[i];
+
+		while (entry)
+		{
+			vector_append(ret, keys ? entry->key : entry->content);
 			entry = entry->next;
-			free(tmp);
 		}
 	}
+}
+
+hashtable_t *hashtable_create(size_t (*hasher)(void*), int (*comparer)(void*, void*))
+{
+	return hashtable_create_ex(hasher, comparer, 0);
+}
+
+hashtable_t *hashtable_create_ex(size_t (*hasher)(void*), int (*comparer)(void*, void*), int flags)
+{
+	return hashtable_create_with_capacity(hasher, comparer, 0, flags);
+}
+
+hashtable_t *hashtable_create_with_capacity(size_t (*hasher)(void*), int (*comparer)(void*, void*), size_t count, int flags)
+{
+	if (!hasher) return NULL;
+	if (!comparer) return NULL;
+
+	hashtable_t *table = malloc(sizeof(hashtable_t));
+	if (!table) return NULL;
+
+	table->flags = flags;
+	table->max_load = HASHTABLE_DEFAULT_MAX_LOAD;
+	size_t capacity = hashtable_fit_capacity(table, count);
+	if (!capacity) { free(table); return NULL; }
+
+	table->entries = calloc(capacity, sizeof(hashtable_entry_t*));
+	if (!table->entries) { free(table); return NULL; }
+
+	table->capacity = capacity;
+	table->count = 0;
+	table->old_entries = NULL;
+	table->old_capacity = 0;
+	table->migrate_index = 0;
+	table->release_index = 0;
+	table->slabs = NULL;
+	table->slab_used = 0;
+	table->free_entries = NULL;
+	table->min_capacity = capacity;
+	table->hasher = hasher;
+	table->comparer = comparer;
+#ifdef SUS_HASHTABLE_STATS
+	memset(&table->counters, 0, sizeof(table->counters));
+#endif
+	hashtable_update_limits(table);
+
+	return table;
+}
+
+int hashtable_destroy(hashtable_t *table)
+{
+	return hashtable_destroy_free(table, NULL, NULL);
+}
+
+int hashtable_destroy_free(hashtable_t *table, void (*free_key)(void *), void (*free_value)(void *))
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	//Entries themselves are released along with their slabs, chains are only walked for the freers
+	if (free_key || free_value)
+	{
+		hashtable_free_chains(table->entries, 0, table->capacity, free_key, free_value);
+
+		if (table->old_entries)
+			hashtable_free_chains(table->old_entries, table->migrate_index, table->old_capacity, free_key, free_value);
+	}
+
+	hashtable_slab_t *slab, *next;
+	for (slab = table->slabs; slab; slab = next)
+	{
+		next = slab->next;
+		free(slab);
+	}
 
+	free(table->old_entries);
 	free(table->entries);
 	free(table);
 
 	return SUS_SUCCESS;
 }
 
-int hashtable_add(hashtable_t *table, void *key, void *value)
+//Links a new entry without checking for an existing key, caller has done the migration step
+static hashtable_entry_t *hashtable_insert(hashtable_t *table, void *key, void *value, size_t hash)
 {
-	if (!table) return SUS_INVALID_ARG;
-
-	if (table->count > table->capacity >> 1) //Force resize on 50% fill
+	if (table->count > table->grow_at)
 	{
 		hashtable_grow(table);
 		//ignore failure, still able to proceed
 	}
 
-	size_t hash_index = table->hasher(key) % table->capacity;
+	size_t hash_index = hashtable_bucket(table, hash, table->capacity);
 	hashtable_entry_t *last_root = table->entries[hash_index];
 
-	hashtable_entry_t *new_entry = malloc(sizeof(hashtable_entry_t));
-	if (!new_entry) return SUS_FAILED_ALLOC;
+	hashtable_entry_t *new_entry = hashtable_alloc_entry(table);
+	if (!new_entry) return NULL;
 
 	new_entry->content = value;
 	new_entry->key = key;
+	new_entry->hash = hash;
 	new_entry->next = last_root;
 	table->entries[hash_index] = new_entry;
 	table->count++;
 
-	return SUS_SUCCESS;
+	return new_entry;
 }
 
-void *hashtable_get(hashtable_t *table, void *key)
+int hashtable_add(hashtable_t *table, void *key, void *value)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	hashtable_migrate_timed(table, HASHTABLE_INCREMENTAL_STEP);
+
+	return hashtable_insert(table, key, value, table->hasher(key)) ? SUS_SUCCESS : SUS_FAILED_ALLOC;
+}
+
+void **hashtable_get_or_insert(hashtable_t *table, void *key, void *value, int *inserted)
 {
 	if (!table) return NULL;
 
-	size_t hash_index = table->hasher(key) % table->capacity;
-	hashtable_entry_t *entry = table->entries[hash_index];
+	hashtable_migrate_timed(table, HASHTABLE_INCREMENTAL_STEP);
+	HASHTABLE_COUNT(table, lookups);
 
-	if (entry == NULL)
-		return NULL;
+	size_t hash = table->hasher(key);
+	hashtable_entry_t **link = hashtable_find(table, key, hash);
 
-	while (entry->next != NULL && table->comparer(key, entry->key))
-		entry = entry->next;
+	if (link)
+	{
+		if (inserted) *inserted = SUS_FALSE;
+		return &(*link)->content;
+	}
 
-	return !table->comparer(key, entry->key) ? entry->content : NULL;
+	//Only reported as inserted once the entry exists, a failed allocation inserted nothing
+	hashtable_entry_t *entry = hashtable_insert(table, key, value, hash);
+	if (inserted) *inserted = entry ? SUS_TRUE : SUS_FALSE;
+	return entry ? &entry->content : NULL;
 }
 
-int hashtable_remove(hashtable_t *table, void *key, void **removed_key, void **removed_content)
+void **hashtable_upsert(hashtable_t *table, void *key, void *value, void **old_value)
+{
+	if (!table) return NULL;
+
+	hashtable_migrate_timed(table, HASHTABLE_INCREMENTAL_STEP);
+	HASHTABLE_COUNT(table, lookups);
+
+	size_t hash = table->hasher(key);
+	hashtable_entry_t **link = hashtable_find(table, key, hash);
+
+	if (link)
+	{
+		if (old_value) *old_value = (*link)->content;
+		(*link)->content = value;
+		return &(*link)->content;
+	}
+
+	if (old_value) *old_value = NULL;
+
+	hashtable_entry_t *entry = hashtable_insert(table, key, value, hash);
+	return entry ? &entry->content : NULL;
+}
+
+void *hashtable_get(hashtable_t *table, void *key)
+{
+	if (!table) return NULL;
+
+	hashtable_migrate_timed(table, HASHTABLE_INCREMENTAL_STEP);
+	HASHTABLE_COUNT(table, lookups);
+
+	hashtable_entry_t **link = hashtable_find(table, key, table->hasher(key));
+
+	return link ? (*link)->content : NULL;
+}
+
+int hashtable_get_many(hashtable_t *table, void **keys, size_t count, void **values)
 {
 	if (!table) return SUS_INVALID_ARG;
+	if (!keys) return SUS_INVALID_ARG;
+	if (!values) return SUS_INVALID_ARG;
 
-	size_t hash_index = table->hasher(key) % table->capacity;
-	hashtable_entry_t *entry = table->entries[hash_index], **ptr_store = &table->entries[hash_index];
+	hashtable_migrate_timed(table, HASHTABLE_INCREMENTAL_STEP);
 
-	if (entry == NULL)
-		return SUS_ENTRY_NOT_FOUND;
+	hashtable_entry_t *found[HASHTABLE_BATCH];
 
-	while (entry->next != NULL && table->comparer(key, entry->key))
+	for (size_t i = 0; i < count; i += HASHTABLE_BATCH)
 	{
-		ptr_store = &entry->next;
-		entry = entry->next;
+		size_t batch = MIN(HASHTABLE_BATCH, count - i);
+		hashtable_find_batch(table, &keys[i], batch, found);
+
+		for (size_t j = 0; j < batch; j++)
+			values[i + j] = found[j] ? found[j]->content : NULL;
 	}
 
-	if (table->comparer(key, entry->key))
+	return SUS_SUCCESS;
+}
+
+int hashtable_remove(hashtable_t *table, void *key, void **removed_key, void **removed_content)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	hashtable_migrate_timed(table, HASHTABLE_INCREMENTAL_STEP);
+	HASHTABLE_COUNT(table, lookups);
+
+	hashtable_entry_t **link = hashtable_find(table, key, table->hasher(key));
+
+	if (!link)
 		return SUS_ENTRY_NOT_FOUND;
-	
+
+	hashtable_entry_t *entry = *link;
+
 	if (removed_key) *removed_key = entry->key;
 	if (removed_content) *removed_content = entry->content;
-	*ptr_store = entry->next;
-	free(entry);
+	*link = entry->next;
+	hashtable_free_entry(table, entry);
 	--table->count;
+
+	if (table->count < table->shrink_at && table->capacity > table->min_capacity)
+	{
+		hashtable_shrink(table);
+		//ignore failure, table stays valid at its current size
+	}
+
 	return SUS_SUCCESS;
 }
 
@@ -201,16 +669,32 @@ int hashtable_has_key(hashtable_t *table, void* key)
 {
 	if (!table) return SUS_INVALID_ARG;
 
-	size_t hash_index = table->hasher(key) % table->capacity;
-	hashtable_entry_t *entry = table->entries[hash_index];
+	hashtable_migrate_timed(table, HASHTABLE_INCREMENTAL_STEP);
+	HASHTABLE_COUNT(table, lookups);
 
-	if (entry == NULL)
-		return SUS_FALSE;
+	return hashtable_find(table, key, table->hasher(key)) ? SUS_TRUE : SUS_FALSE;
+}
 
-	while (entry->next != NULL && table->comparer(key, entry->key))
-		entry = entry->next;
+int hashtable_has_keys(hashtable_t *table, void **keys, size_t count, int *results)
+{
+	if (!table) return SUS_INVALID_ARG;
+	if (!keys) return SUS_INVALID_ARG;
+	if (!results) return SUS_INVALID_ARG;
+
+	hashtable_migrate_timed(table, HASHTABLE_INCREMENTAL_STEP);
+
+	hashtable_entry_t *found[HASHTABLE_BATCH];
+
+	for (size_t i = 0; i < count; i += HASHTABLE_BATCH)
+	{
+		size_t batch = MIN(HASHTABLE_BATCH, count - i);
+		hashtable_find_batch(table, &keys[i], batch, found);
 
-	return !table->comparer(key, entry->key) ? SUS_TRUE : SUS_FALSE;
+		for (size_t j = 0; j < batch; j++)
+			results[i + j] = found[j] ? SUS_TRUE : SUS_FALSE;
+	}
+
+	return SUS_SUCCESS;
 }
 
 vector_t *hashtable_list_keys(hashtable_t *table)
@@ -226,16 +710,9 @@ vector_t *hashtable_list_keys(hashtable_t *table)
 		return NULL;
 	}
 
-	for (size_t i = 0; i < table->capacity; i++)
-	{
-		hashtable_entry_t *entry = table->entries[i];
-
-		while (entry)
-		{
-			vector_append(ret, entry->key);
-			entry = entry->next;
-		}
-	}
+	hashtable_collect(ret, table->entries, 0, table->capacity, 1);
+	if (table->old_entries)
+		hashtable_collect(ret, table->old_entries, table->migrate_index, table->old_capacity, 1);
 
 	return ret;
 }
@@ -253,62 +730,202 @@ vector_t *hashtable_list_contents(hashtable_t *table)
 		return NULL;
 	}
 
-	for (size_t i = 0; i < table->capacity; i++)
-	{
-		hashtable_entry_t *entry = table->entries[i];
+	hashtable_collect(ret, table->entries, 0, table->capacity, 0);
+	if (table->old_entries)
+		hashtable_collect(ret, table->old_entries, table->migrate_index, table->old_capacity, 0);
 
-		while (entry)
+	return ret;
+}
+
+int hashtable_reserve(hashtable_t *table, size_t count)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	size_t capacity = hashtable_fit_capacity(table, count);
+	if (!capacity) return SUS_FAILED_ALLOC;
+
+	table->min_capacity = MAX(table->min_capacity, capacity);
+
+	if (capacity <= table->capacity)
+		return SUS_SUCCESS;
+
+	return hashtable_resize(table, capacity);
+}
+
+int hashtable_set_max_load(hashtable_t *table, double max_load)
+{
+	if (!table) return SUS_INVALID_ARG;
+	if (!(max_load > 0)) return SUS_INVALID_ARG;
+
+	table->max_load = max_load;
+	hashtable_update_limits(table);
+
+	return SUS_SUCCESS;
+}
+
+int hashtable_iter_begin(hashtable_t *table, hashtable_iter_t *iter)
+{
+	if (!table) return SUS_INVALID_ARG;
+	if (!iter) return SUS_INVALID_ARG;
+
+	//Finish any incremental resize so only one bucket array has to be walked
+	hashtable_migrate_timed(table, SIZE_MAX);
+
+	iter->table = table;
+	iter->bucket = 0;
+	iter->link = &table->entries[0];
+	iter->entry = NULL;
+
+	return SUS_SUCCESS;
+}
+
+int hashtable_iter_next(hashtable_iter_t *iter, void **key, void **value)
+{
+	if (!iter) return SUS_INVALID_ARG;
+
+	hashtable_t *table = iter->table;
+	hashtable_entry_t **link = iter->link;
+	hashtable_entry_t *entry = iter->entry;
+
+	//No current entry (just began or it was removed) means link already points at the next one
+	if (entry)
+		link = &entry->next;
+
+	while (!*link)
+	{
+		if (++iter->bucket >= table->capacity)
 		{
-			vector_append(ret, entry->content);
-			entry = entry->next;
+			iter->bucket = table->capacity;
+			iter->link = link;
+			iter->entry = NULL;
+			return SUS_FALSE;
 		}
+
+		link = &table->entries[iter->bucket];
 	}
 
-	return ret;
+	entry = *link;
+	iter->link = link;
+	iter->entry = entry;
+
+	if (key) *key = entry->key;
+	if (value) *value = entry->content;
+
+	return SUS_TRUE;
+}
+
+int hashtable_iter_remove(hashtable_iter_t *iter, void **removed_key, void **removed_content)
+{
+	if (!iter) return SUS_INVALID_ARG;
+	if (!iter->entry) return SUS_ENTRY_NOT_FOUND;
+
+	hashtable_entry_t **link = iter->link;
+	hashtable_entry_t *entry = iter->entry;
+
+	if (removed_key) *removed_key = entry->key;
+	if (removed_content) *removed_content = entry->content;
+	*link = entry->next;
+	hashtable_free_entry(iter->table, entry);
+	--iter->table->count;
+	iter->entry = NULL;
+
+	return SUS_SUCCESS;
+}
+
+int hashtable_foreach(hashtable_t *table, int (*func)(void *, void *, void *), void *arg)
+{
+	if (!table) return SUS_INVALID_ARG;
+	if (!func) return SUS_INVALID_ARG;
+
+	hashtable_iter_t iter;
+	void *key, *value;
+
+	hashtable_iter_begin(table, &iter);
+
+	while (hashtable_iter_next(&iter, &key, &value) == SUS_TRUE)
+	{
+		int action = func(key, value, arg);
+
+		if (action & HASHTABLE_ITER_REMOVE)
+			hashtable_iter_remove(&iter, NULL, NULL);
+
+		if (action & HASHTABLE_ITER_STOP)
+			break;
+	}
+
+	return SUS_SUCCESS;
 }
 
 int hashtable_resize(hashtable_t *table, size_t capacity)
 {
 	if (!table) return SUS_INVALID_ARG;
+	if (!capacity) return SUS_INVALID_ARG;
+
+	if (table->flags & HASHTABLE_FLAG_POW2)
+	{
+		capacity = round_pow2(capacity, 1);
+		if (!capacity) return SUS_FAILED_ALLOC;
+	}
+
+	hashtable_migrate_timed(table, SIZE_MAX);
 
 	if (table->capacity == capacity)
 		return SUS_SUCCESS;
 
-	vector_t *keys = hashtable_list_keys(table);
-	if (!keys) return SUS_FAILED_ALLOC;
-	vector_t *values = hashtable_list_contents(table);
-	if (!values) { vector_destroy(keys); return SUS_FAILED_ALLOC; }
+	//Existing nodes are relinked into the new array, nothing is copied or reallocated
+	uint64_t start = hashtable_clock();
+	int err = hashtable_begin_migration(table, capacity);
+	if (err) return err;
+
+	hashtable_migrate(table, SIZE_MAX);
+	hashtable_count_resize(table, start);
 
-	hashtable_entry_t *entry, *prev;
+	return SUS_SUCCESS;
+}
 
-	for (size_t i = 0; i < table->capacity; i++)
+static void hashtable_chain_stats(hashtable_entry_t **entries, size_t start, size_t end, hashtable_stats_t *stats, size_t *used)
+{
+	for (size_t i = start; i < end; i++)
 	{
-		entry = table->entries[i];
-		
-		while (entry)
-		{
-			prev = entry;
-			entry = entry->next;
-			free(prev);
-		}
+		size_t length = 0;
+
+		for (hashtable_entry_t *entry = entries[i]; entry; entry = entry->next)
+			length++;
+
+		stats->chain_histogram[MIN(length, HASHTABLE_STATS_CHAINS - 1)]++;
+		stats->max_chain = MAX(stats->max_chain, length);
+		if (length) (*used)++;
 	}
+}
 
-	hashtable_entry_t **tmp = malloc(capacity * sizeof(hashtable_entry_t*));
-	if (!tmp) { vector_destroy(keys); vector_destroy(values); return SUS_FAILED_ALLOC; }
+int hashtable_get_stats(hashtable_t *table, hashtable_stats_t *stats)
+{
+	if (!table) return SUS_INVALID_ARG;
+	if (!stats) return SUS_INVALID_ARG;
 
-	memset(tmp, 0, sizeof(hashtable_entry_t*) * capacity);
+	memset(stats, 0, sizeof(hashtable_stats_t));
 
-	free(table->entries);
-	table->entries = tmp;
-	table->capacity = capacity;
-	table->count = 0;
+	size_t used = 0;
+	hashtable_chain_stats(table->entries, 0, table->capacity, stats, &used);
+	if (table->old_entries)
+		hashtable_chain_stats(table->old_entries, table->migrate_index, table->old_capacity, stats, &used);
 
-	for (size_t i = 0; i < keys->count; i++)
-		hashtable_add(table, keys->data[i], values->data[i]);
+	stats->count = table->count;
+	stats->capacity = table->capacity;
+	stats->load_factor = (double)table->count / table->capacity;
+	stats->avg_chain = used ? (double)table->count / used : 0;
+	stats->bucket_bytes = (table->capacity + table->old_capacity) * sizeof(hashtable_entry_t*);
 
-	vector_destroy(keys);
-	vector_destroy(values);
+	for (hashtable_slab_t *slab = table->slabs; slab; slab = slab->next)
+		stats->node_bytes += sizeof(hashtable_slab_t) + slab->capacity * sizeof(hashtable_entry_t);
+
+#ifdef SUS_HASHTABLE_STATS
+	stats->lookups = table->counters.lookups;
+	stats->comparer_calls = table->counters.comparer_calls;
+	stats->resizes = table->counters.resizes;
+	stats->resize_ns = table->counters.resize_ns;
+	stats->max_resize_ns = table->counters.max_resize_ns;
+#endif
 
 	return SUS_SUCCESS;
 }
-
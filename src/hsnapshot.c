@@ -0,0 +1,327 @@
+#include "hsnapshot.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sus.h"
+#include "fmix.h"
+#include "hashtable.h"
+
+
+
+//File layout, all offsets are from the start of the file so it can be mapped anywhere:
+//header | uint64 bucket starts[bucket_count + 1] | entries[entry_count] sorted by bucket | packed keys and values
+#define HSNAPSHOT_MAGIC "SUSHSNP3"
+#define HSNAPSHOT_ALIGN 8
+#define HSNAPSHOT_TMP_SUFFIX ".tmp"
+//Stored keys rehashed on open to make sure hasher (and its seed) still gives the hashes the file was built with
+#define HSNAPSHOT_HASH_CHECKS 4
+
+typedef struct
+{
+	char magic[8];
+	uint64_t bucket_count;
+	uint64_t entry_count;
+	uint64_t buckets_offset;
+	uint64_t entries_offset;
+	uint64_t file_size;
+} hsnapshot_header_t;
+
+typedef struct
+{
+	uint64_t hash;
+	uint64_t key_offset;
+	uint64_t key_size;
+	uint64_t value_offset;
+	uint64_t value_size;
+} hsnapshot_entry_t;
+
+struct hsnapshot_t
+{
+	const unsigned char *base;
+	size_t size;
+	const uint64_t *buckets;
+	const hsnapshot_entry_t *entries;
+	uint64_t bucket_count;
+	uint64_t entry_count;
+	size_t (*hasher)(void*);
+	int (*comparer)(void*, void*);
+};
+
+typedef struct
+{
+	void *key;
+	void *value;
+	uint64_t hash;
+	uint64_t bucket;
+} hsnapshot_record_t;
+
+
+
+#define HSNAPSHOT_PAD(size) (((size) + HSNAPSHOT_ALIGN - 1) & ~(uint64_t)(HSNAPSHOT_ALIGN - 1))
+
+static inline uint64_t hsnapshot_bucket(uint64_t hash, uint64_t bucket_count)
+{
+	return hash_fmix64(hash) & (bucket_count - 1);
+}
+
+static int hsnapshot_write_padded(FILE *file, const void *data, size_t size)
+{
+	static const char zeros[HSNAPSHOT_ALIGN] = { 0 };
+
+	if (size && fwrite(data, 1, size, file) != size) return SUS_ERR;
+
+	size_t pad = HSNAPSHOT_PAD(size) - size;
+	if (pad && fwrite(zeros, 1, pad, file) != pad) return SUS_ERR;
+
+	return SUS_SUCCESS;
+}
+
+int hsnapshot_save(hashtable_t *table, const char *path, size_t (*hasher)(void*), size_t (*key_size)(void*), size_t (*value_size)(void*))
+{
+	if (!table) return SUS_INVALID_ARG;
+	if (!path) return SUS_INVALID_ARG;
+	if (!hasher) return SUS_INVALID_ARG;
+	if (!key_size) return SUS_INVALID_ARG;
+	if (!value_size) return SUS_INVALID_ARG;
+
+	size_t count = hashtable_get_count(table);
+	uint64_t bucket_count = 1;
+	while (bucket_count < count) bucket_count <<= 1;
+
+	hsnapshot_record_t *records = malloc((count ? count : 1) * sizeof(hsnapshot_record_t));
+	hsnapshot_record_t *sorted = malloc((count ? count : 1) * sizeof(hsnapshot_record_t));
+	uint64_t *buckets = calloc(bucket_count + 1, sizeof(uint64_t));
+	if (!records || !sorted || !buckets) { free(records); free(sorted); free(buckets); return SUS_FAILED_ALLOC; }
+
+	hashtable_iter_t iter;
+	size_t n = 0;
+	hashtable_iter_begin(table, &iter);
+
+	while (n < count && hashtable_iter_next(&iter, &records[n].key, &records[n].value) == SUS_TRUE)
+	{
+		records[n].hash = hasher(records[n].key);
+		records[n].bucket = hsnapshot_bucket(records[n].hash, bucket_count);
+		buckets[records[n].bucket + 1]++;
+		n++;
+	}
+
+	//Counting sort by bucket, buckets[b] ends up as the first entry index of bucket b
+	for (uint64_t b = 0; b < bucket_count; b++)
+		buckets[b + 1] += buckets[b];
+
+	for (size_t i = 0; i < n; i++)
+		sorted[buckets[records[i].bucket]++] = records[i];
+
+	memmove(&buckets[1], buckets, bucket_count * sizeof(uint64_t));
+	buckets[0] = 0;
+	free(records);
+
+	hsnapshot_header_t header;
+	memcpy(header.magic, HSNAPSHOT_MAGIC, sizeof(header.magic));
+	header.bucket_count = bucket_count;
+	header.entry_count = n;
+	header.buckets_offset = HSNAPSHOT_PAD(sizeof(hsnapshot_header_t));
+	header.entries_offset = header.buckets_offset + HSNAPSHOT_PAD((bucket_count + 1) * sizeof(uint64_t));
+
+	uint64_t offset = header.entries_offset + n * sizeof(hsnapshot_entry_t);
+	for (size_t i = 0; i < n; i++)
+		offset += HSNAPSHOT_PAD(key_size(sorted[i].key)) + HSNAPSHOT_PAD(value_size(sorted[i].value));
+	header.file_size = offset;
+
+	//Readers may have path mapped, it is replaced by rename so they keep the old inode instead of seeing it rewritten
+	size_t path_len = strlen(path);
+	char *tmp_path = malloc(path_len + sizeof(HSNAPSHOT_TMP_SUFFIX));
+	if (!tmp_path) { free(sorted); free(buckets); return SUS_FAILED_ALLOC; }
+	memcpy(tmp_path, path, path_len);
+	memcpy(tmp_path + path_len, HSNAPSHOT_TMP_SUFFIX, sizeof(HSNAPSHOT_TMP_SUFFIX));
+
+	FILE *file = fopen(tmp_path, "wb");
+	if (!file) { free(tmp_path); free(sorted); free(buckets); return SUS_ERR; }
+
+	int err = hsnapshot_write_padded(file, &header, sizeof(header));
+	if (!err) err = hsnapshot_write_padded(file, buckets, (bucket_count + 1) * sizeof(uint64_t));
+
+	offset = header.entries_offset + n * sizeof(hsnapshot_entry_t);
+	for (size_t i = 0; i < n && !err; i++)
+	{
+		hsnapshot_entry_t entry;
+		entry.hash = sorted[i].hash;
+		entry.key_offset = offset;
+		entry.key_size = key_size(sorted[i].key);
+		offset += HSNAPSHOT_PAD(entry.key_size);
+		entry.value_offset = offset;
+		entry.value_size = value_size(sorted[i].value);
+		offset += HSNAPSHOT_PAD(entry.value_size);
+
+		if (fwrite(&entry, sizeof(entry), 1, file) != 1) err = SUS_ERR;
+	}
+
+	for (size_t i = 0; i < n && !err; i++)
+	{
+		err = hsnapshot_write_padded(file, sorted[i].key, key_size(sorted[i].key));
+		if (!err) err = hsnapshot_write_padded(file, sorted[i].value, value_size(sorted[i].value));
+	}
+
+	if (!err && (fflush(file) || fsync(fileno(file)))) err = SUS_ERR;
+	if (fclose(file) && !err) err = SUS_ERR;
+	if (!err && rename(tmp_path, path)) err = SUS_ERR;
+	if (err) remove(tmp_path);
+
+	free(tmp_path);
+	free(sorted);
+	free(buckets);
+
+	return err;
+}
+
+//Only the header is checked on open so a cold start stays O(1), bucket starts and entries are checked by the lookups reading them
+//Sizes are compared against what is left of the file by division first, nothing below can overflow
+static int hsnapshot_valid(const unsigned char *base, uint64_t size)
+{
+	const hsnapshot_header_t *header = (const hsnapshot_header_t *)base;
+	uint64_t bucket_count = header->bucket_count, entry_count = header->entry_count;
+	uint64_t buckets_offset = header->buckets_offset, entries_offset = header->entries_offset;
+
+	if (memcmp(header->magic, HSNAPSHOT_MAGIC, sizeof(header->magic)) || header->file_size != size) return SUS_FALSE;
+	if (!bucket_count || (bucket_count & (bucket_count - 1))) return SUS_FALSE;
+	if (buckets_offset % HSNAPSHOT_ALIGN || entries_offset % HSNAPSHOT_ALIGN) return SUS_FALSE;
+
+	if (buckets_offset < sizeof(hsnapshot_header_t) || buckets_offset > size) return SUS_FALSE;
+	if (bucket_count >= (size - buckets_offset) / sizeof(uint64_t)) return SUS_FALSE;
+	if (entries_offset < buckets_offset + (bucket_count + 1) * sizeof(uint64_t) || entries_offset > size) return SUS_FALSE;
+	if (entry_count > (size - entries_offset) / sizeof(hsnapshot_entry_t)) return SUS_FALSE;
+
+	return SUS_TRUE;
+}
+
+//Key and value of entry lie inside the file
+static inline int hsnapshot_entry_valid(const hsnapshot_entry_t *entry, uint64_t size)
+{
+	if (entry->key_offset > size || entry->key_size > size - entry->key_offset) return SUS_FALSE;
+	if (entry->value_offset > size || entry->value_size > size - entry->value_offset) return SUS_FALSE;
+
+	return SUS_TRUE;
+}
+
+//Bucket placement depends on the hasher output, a different hasher or hash_set_seed would silently miss every key
+static int hsnapshot_same_hasher(const unsigned char *base, size_t (*hasher)(void*))
+{
+	const hsnapshot_header_t *header = (const hsnapshot_header_t *)base;
+	const hsnapshot_entry_t *entries = (const hsnapshot_entry_t *)(base + header->entries_offset);
+	uint64_t step = header->entry_count / HSNAPSHOT_HASH_CHECKS + 1;
+
+	for (uint64_t i = 0; i < header->entry_count; i += step)
+	{
+		if (!hsnapshot_entry_valid(&entries[i], header->file_size)) return SUS_FALSE;
+		if ((uint64_t)hasher((void *)(base + entries[i].key_offset)) != entries[i].hash) return SUS_FALSE;
+	}
+
+	return SUS_TRUE;
+}
+
+hsnapshot_t *hsnapshot_open(const char *path, size_t (*hasher)(void*), int (*comparer)(void*, void*))
+{
+	if (!path) return NULL;
+	if (!hasher) return NULL;
+	if (!comparer) return NULL;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st) || (size_t)st.st_size < sizeof(hsnapshot_header_t)) { close(fd); return NULL; }
+
+	//Shared read only mapping, processes opening the same file share its pages
+	void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) return NULL;
+
+	const hsnapshot_header_t *header = base;
+	uint64_t bucket_count = header->bucket_count;
+
+	if (!hsnapshot_valid(base, st.st_size) || !hsnapshot_same_hasher(base, hasher))
+	{
+		munmap(base, st.st_size);
+		return NULL;
+	}
+
+	hsnapshot_t *snapshot = malloc(sizeof(hsnapshot_t));
+	if (!snapshot) { munmap(base, st.st_size); return NULL; }
+
+	snapshot->base = base;
+	snapshot->size = st.st_size;
+	snapshot->buckets = (const uint64_t *)(snapshot->base + header->buckets_offset);
+	snapshot->entries = (const hsnapshot_entry_t *)(snapshot->base + header->entries_offset);
+	snapshot->bucket_count = bucket_count;
+	snapshot->entry_count = header->entry_count;
+	snapshot->hasher = hasher;
+	snapshot->comparer = comparer;
+
+	return snapshot;
+}
+
+int hsnapshot_close(hsnapshot_t *snapshot)
+{
+	if (!snapshot) return SUS_INVALID_ARG;
+
+	munmap((void *)snapshot->base, snapshot->size);
+	free(snapshot);
+
+	return SUS_SUCCESS;
+}
+
+static const hsnapshot_entry_t *hsnapshot_find(hsnapshot_t *snapshot, void *key)
+{
+	uint64_t hash = snapshot->hasher(key);
+	uint64_t bucket = hsnapshot_bucket(hash, snapshot->bucket_count);
+	uint64_t begin = snapshot->buckets[bucket], end = snapshot->buckets[bucket + 1];
+
+	//A corrupt bucket or entry reads as a miss rather than out of bounds
+	if (begin > end || end > snapshot->entry_count) return NULL;
+
+	for (uint64_t i = begin; i < end; i++)
+	{
+		const hsnapshot_entry_t *entry = &snapshot->entries[i];
+		if (entry->hash != hash) continue;
+		if (!hsnapshot_entry_valid(entry, snapshot->size)) return NULL;
+
+		if (!snapshot->comparer(key, (void *)(snapshot->base + entry->key_offset)))
+			return entry;
+	}
+
+	return NULL;
+}
+
+void *hsnapshot_get(hsnapshot_t *snapshot, void *key, size_t *value_size)
+{
+	if (!snapshot) return NULL;
+
+	const hsnapshot_entry_t *entry = hsnapshot_find(snapshot, key);
+	if (!entry) return NULL;
+
+	if (value_size) *value_size = entry->value_size;
+	return (void *)(snapshot->base + entry->value_offset);
+}
+
+int hsnapshot_has_key(hsnapshot_t *snapshot, void *key)
+{
+	if (!snapshot) return SUS_INVALID_ARG;
+
+	return hsnapshot_find(snapshot, key) ? SUS_TRUE : SUS_FALSE;
+}
+
+size_t hsnapshot_get_count(hsnapshot_t *snapshot)
+{
+	if (!snapshot)
+		return 0;
+
+	return snapshot->entry_count;
+}
@@ -0,0 +1,247 @@
+#include "ideque.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "sus.h"
+
+#define SLOT(deque, idx) (((deque)->head + (idx)) & ((deque)->capacity - 1))
+#define ADDR(deque, slot) (void*)((char*)((deque)->data) + (slot) * (deque)->element_size)
+#define AT(deque, idx) ADDR(deque, SLOT(deque, idx))
+
+
+
+ideque_t *ideque_create(size_t element_size)
+{
+	ideque_t *ret = malloc(sizeof(ideque_t));
+	if (!ret) return NULL;
+
+	ret->data = malloc(IDEQUE_DEFAULT_CAP * element_size);
+	if (!ret->data) { free(ret); return NULL; }
+
+	ret->capacity = IDEQUE_DEFAULT_CAP;
+	ret->head = 0;
+	ret->count = 0;
+	ret->element_size = element_size;
+
+	return ret;
+}
+
+int ideque_destroy(ideque_t *deque)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	free(deque->data);
+	free(deque);
+
+	return SUS_SUCCESS;
+}
+
+ideque_t *ideque_duplicate(ideque_t *deque)
+{
+	if (!deque) return NULL;
+
+	ideque_t *ret = ideque_create(deque->element_size);
+	if (!ret) return NULL;
+
+	if (ideque_ensure(ret, deque->count))
+	{
+		ideque_destroy(ret);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < deque->count; i++)
+		memcpy(ADDR(ret, i), AT(deque, i), deque->element_size);
+	ret->count = deque->count;
+
+	return ret;
+}
+
+//Moves the elements to a new buffer of capacity slots, unwrapped so head becomes 0
+static int ideque_set_capacity(ideque_t *deque, size_t capacity)
+{
+	char *tmp = malloc(capacity * deque->element_size);
+	if (!tmp) return SUS_FAILED_ALLOC;
+
+	size_t first = deque->capacity - deque->head;
+	if (first > deque->count) first = deque->count;
+
+	memcpy(tmp, ADDR(deque, deque->head), first * deque->element_size);
+	memcpy(tmp + first * deque->element_size, deque->data, (deque->count - first) * deque->element_size);
+
+	free(deque->data);
+	deque->data = tmp;
+	deque->capacity = capacity;
+	deque->head = 0;
+
+	return SUS_SUCCESS;
+}
+
+int ideque_ensure(ideque_t *deque, size_t capacity)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (deque->capacity >= capacity) return SUS_SUCCESS;
+
+	size_t new_capacity = deque->capacity;
+	while (new_capacity < capacity) new_capacity <<= 1;
+
+	return ideque_set_capacity(deque, new_capacity);
+}
+
+int ideque_trim(ideque_t *deque)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	//Capacity has to stay a power of two, so trim to the smallest one that fits
+	size_t capacity = IDEQUE_DEFAULT_CAP;
+	while (capacity < deque->count) capacity <<= 1;
+	if (capacity == deque->capacity) return SUS_SUCCESS;
+
+	return ideque_set_capacity(deque, capacity);
+}
+
+int ideque_push_back(ideque_t *deque, void *data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	int err = ideque_ensure(deque, deque->count + 1);
+	if (err) return err;
+
+	memcpy(AT(deque, deque->count), data, deque->element_size);
+	deque->count++;
+	return SUS_SUCCESS;
+}
+
+int ideque_push_front(ideque_t *deque, void *data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	int err = ideque_ensure(deque, deque->count + 1);
+	if (err) return err;
+
+	deque->head = (deque->head - 1) & (deque->capacity - 1);
+	memcpy(ADDR(deque, deque->head), data, deque->element_size);
+	deque->count++;
+	return SUS_SUCCESS;
+}
+
+int ideque_pop_back(ideque_t *deque, void *data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	if (!deque->count)
+		return SUS_INVALID_INDEX;
+
+	deque->count--;
+	if (data) memcpy(data, AT(deque, deque->count), deque->element_size);
+	return SUS_SUCCESS;
+}
+
+int ideque_pop_front(ideque_t *deque, void *data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	if (!deque->count)
+		return SUS_INVALID_INDEX;
+
+	if (data) memcpy(data, ADDR(deque, deque->head), deque->element_size);
+	deque->head = SLOT(deque, 1);
+	deque->count--;
+	return SUS_SUCCESS;
+}
+
+int ideque_insert_at(ideque_t *deque, void *data, size_t index)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (index > deque->count) return SUS_INVALID_INDEX;
+
+	int err = ideque_ensure(deque, deque->count + 1);
+	if (err) return err;
+
+	if (index < deque->count / 2)
+	{
+		deque->head = (deque->head - 1) & (deque->capacity - 1);
+		for (size_t i = 0; i < index; i++)
+			memcpy(AT(deque, i), AT(deque, i + 1), deque->element_size);
+	}
+	else
+	{
+		for (size_t i = deque->count; i > index; i--)
+			memcpy(AT(deque, i), AT(deque, i - 1), deque->element_size);
+	}
+
+	memcpy(AT(deque, index), data, deque->element_size);
+	deque->count++;
+	return SUS_SUCCESS;
+}
+
+int ideque_remove_at(ideque_t *deque, size_t index)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	if (index >= deque->count)
+		return SUS_INVALID_INDEX;
+
+	if (index < deque->count / 2)
+	{
+		for (size_t i = index; i > 0; i--)
+			memcpy(AT(deque, i), AT(deque, i - 1), deque->element_size);
+		deque->head = SLOT(deque, 1);
+	}
+	else
+	{
+		for (size_t i = index; i + 1 < deque->count; i++)
+			memcpy(AT(deque, i), AT(deque, i + 1), deque->element_size);
+	}
+
+	deque->count--;
+	return SUS_SUCCESS;
+}
+
+int ideque_clear(ideque_t *deque)
+{
+	if (!deque) return SUS_INVALID_ARG;
+
+	deque->head = 0;
+	deque->count = 0;
+	return SUS_SUCCESS;
+}
+
+void *ideque_get(ideque_t *deque, size_t index)
+{
+	if (!deque) return NULL;
+	if (index >= deque->count) return NULL;
+
+	return AT(deque, index);
+}
+
+int ideque_set(ideque_t *deque, size_t index, void *data)
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (index >= deque->count) return SUS_INVALID_INDEX;
+
+	memcpy(AT(deque, index), data, deque->element_size);
+	return SUS_SUCCESS;
+}
+
+void *ideque_front(ideque_t *deque)
+{
+	return ideque_get(deque, 0);
+}
+
+void *ideque_back(ideque_t *deque)
+{
+	if (!deque || !deque->count) return NULL;
+
+	return AT(deque, deque->count - 1);
+}
+
+int ideque_iterate(ideque_t *deque, void (*func)(void *))
+{
+	if (!deque) return SUS_INVALID_ARG;
+	if (!func) return SUS_INVALID_ARG;
+
+	for (size_t i = 0; i < deque->count; i++)
+		func(AT(deque, i));
+
+	return SUS_SUCCESS;
+}
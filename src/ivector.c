@@ -3,8 +3,13 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "sus.h"
+#include "math_utils.h"
+#include "workers.h"
+#include "mapped.h"
+#include "parallel.h"
 
 #define ADDR(vec, idx) (void*)((char*)((vec)->data) + (idx) * (vec)->element_size)
 
@@ -21,15 +26,117 @@ ivector_t *ivector_create(size_t element_size)
 	ret->count = 0;
 	ret->capacity = IVECTOR_DEFAULT_CAP;
 	ret->element_size = element_size;
+	ret->flags = 0;
 
 	return ret;
 }
 
+//Frees the storage in whichever way it was obtained, borrowed storage is left alone
+static void ivector_release(ivector_t *vec)
+{
+	if (vec->flags & IVECTOR_FLAG_MAPPED)
+		mapped_free(vec->data, vec->capacity * vec->element_size);
+	else if (!(vec->flags & IVECTOR_FLAG_BORROWED))
+		free(vec->data);
+}
+
+//Moves the elements into storage for capacity elements, mapped once it reaches IVECTOR_MAP_MIN bytes
+//Mapped storage fills its last page, so capacity may come out larger
+static int ivector_resize(ivector_t *vec, size_t capacity)
+{
+	size_t bytes = capacity * vec->element_size, old_bytes = vec->capacity * vec->element_size;
+	int huge = vec->flags & IVECTOR_FLAG_HUGE_PAGES;
+	int mapped = bytes >= IVECTOR_MAP_MIN;
+	void *tmp = NULL;
+
+	if (!capacity)
+	{
+		ivector_release(vec);
+	}
+	else if (mapped && (vec->flags & IVECTOR_FLAG_MAPPED))
+	{
+		tmp = mapped_realloc(vec->data, old_bytes, bytes, huge);
+		if (!tmp) return SUS_FAILED_ALLOC;
+	}
+	else if (!mapped && !(vec->flags & (IVECTOR_FLAG_MAPPED | IVECTOR_FLAG_BORROWED)))
+	{
+		tmp = realloc(vec->data, bytes);
+		if (!tmp) return SUS_FAILED_ALLOC;
+	}
+	else
+	{
+		//Switching kinds of storage, the elements are copied once and the old storage released
+		tmp = mapped ? mapped_alloc(bytes, huge) : malloc(bytes);
+		if (!tmp) return SUS_FAILED_ALLOC;
+
+		memcpy(tmp, vec->data, MIN(vec->count, capacity) * vec->element_size);
+		ivector_release(vec);
+	}
+
+	vec->data = tmp;
+	vec->capacity = mapped ? mapped_capacity(capacity, vec->element_size) : capacity;
+	vec->flags &= ~(IVECTOR_FLAG_MAPPED | IVECTOR_FLAG_BORROWED);
+	if (mapped) vec->flags |= IVECTOR_FLAG_MAPPED;
+
+	return SUS_SUCCESS;
+}
+
+//Smallest capacity the growth policy reaches that holds at least target elements
+static size_t ivector_grow(ivector_t *vec, size_t target)
+{
+	size_t capacity = MAX(vec->capacity, IVECTOR_DEFAULT_CAP);
+	size_t step = MAX(IVECTOR_GROW_STEP / MAX(vec->element_size, 1), 1);
+
+	while (capacity < target)
+	{
+		if ((vec->flags & IVECTOR_FLAG_GROW_STEP) && capacity >= step)
+			capacity = MAX(capacity + step, DIV_CEIL(target, step) * step);
+		else if (vec->flags & IVECTOR_FLAG_GROW_HALF)
+			capacity += capacity / 2;
+		else
+			capacity <<= 1;
+	}
+
+	return capacity;
+}
+
+int ivector_init(ivector_t *vec, size_t element_size)
+{
+	return ivector_init_buffer(vec, element_size, NULL, 0);
+}
+
+int ivector_init_buffer(ivector_t *vec, size_t element_size, void *buf, size_t capacity)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!buf && capacity) return SUS_INVALID_ARG;
+
+	vec->data = buf;
+	vec->capacity = capacity;
+	vec->count = 0;
+	vec->element_size = element_size;
+	vec->flags = buf ? IVECTOR_FLAG_BORROWED : 0;
+
+	return SUS_SUCCESS;
+}
+
+int ivector_deinit(ivector_t *vec)
+{
+	if (!vec) return SUS_INVALID_ARG;
+
+	int growth = vec->flags & IVECTOR_GROWTH_FLAGS;
+
+	ivector_release(vec);
+	ivector_init(vec, vec->element_size);
+	vec->flags = growth;
+
+	return SUS_SUCCESS;
+}
+
 int ivector_destroy(ivector_t *vec)
 {
 	if (!vec) return SUS_INVALID_ARG;
 
-	free(vec->data);
+	ivector_release(vec);
 	free(vec);
 
 	return SUS_SUCCESS;
@@ -42,6 +149,7 @@ ivector_t *ivector_duplicate(ivector_t *vec)
 	if (!ret)
 		return NULL;
 
+	ret->flags = vec->flags & IVECTOR_GROWTH_FLAGS;
 	if (ivector_ensure(ret, vec->count))
 	{
 		ivector_destroy(ret);
@@ -76,32 +184,25 @@ int ivector_ensure(ivector_t *vec, size_t capacity)
 {
 	if (!vec) return SUS_INVALID_ARG;
 	if (vec->capacity >= capacity) return SUS_SUCCESS;
-	size_t old_capacity = vec->capacity;
-
-	if (vec->capacity < IVECTOR_DEFAULT_CAP) vec->capacity = IVECTOR_DEFAULT_CAP;
-	while (vec->capacity < capacity) vec->capacity <<= 1;
-
-	void *tmp = realloc(vec->data, vec->capacity * vec->element_size);
-	if (!tmp) 
-	{
-		vec->capacity = old_capacity;
-		return SUS_FAILED_ALLOC;
-	}
 
-	vec->data = tmp;
-	return SUS_SUCCESS;
+	return ivector_resize(vec, ivector_grow(vec, capacity));
 }
 
 int ivector_trim(ivector_t *vec)
 {
 	if (!vec) return SUS_INVALID_ARG;
 	if (vec->count == vec->capacity) return SUS_SUCCESS;
+	if (vec->flags & IVECTOR_FLAG_BORROWED) return SUS_SUCCESS;
 
-	void *tmp = realloc(vec->data, vec->count * vec->element_size);
-	if (!tmp) return SUS_FAILED_ALLOC;
+	return ivector_resize(vec, vec->count);
+}
 
-	vec->data = tmp;
-	vec->capacity = vec->count;
+int ivector_set_growth(ivector_t *vec, int flags)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (flags & ~IVECTOR_GROWTH_FLAGS) return SUS_INVALID_ARG;
+
+	vec->flags = (vec->flags & ~IVECTOR_GROWTH_FLAGS) | flags;
 	return SUS_SUCCESS;
 }
 
@@ -218,6 +319,69 @@ int ivector_remove_range(ivector_t *vec, size_t start, size_t count)
 	return SUS_SUCCESS;
 }
 
+int ivector_insert_range_at(ivector_t *vec, ivector_t *src, size_t start, size_t count, size_t index)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!src) return SUS_INVALID_ARG;
+	if (vec->element_size != src->element_size) return SUS_INCOMPATIBLE_IVECTORS;
+	if (start > src->count || count > src->count - start) return SUS_INVALID_RANGE;
+	if (index > vec->count) return SUS_INVALID_INDEX;
+
+	int err = ivector_ensure(vec, vec->count + count);
+	if (err) return err;
+
+	memmove(ADDR(vec, index + count), ADDR(vec, index), (vec->count - index) * vec->element_size);
+
+	//Inserting a vector into itself, the part of the range at or past index was just shifted by count
+	if (src == vec && start + count > index)
+	{
+		size_t before = start < index ? index - start : 0;
+		memcpy(ADDR(vec, index), ADDR(vec, start), before * vec->element_size);
+		memcpy(ADDR(vec, index + before), ADDR(vec, start + before + count), (count - before) * vec->element_size);
+	}
+	else
+	{
+		memcpy(ADDR(vec, index), ADDR(src, start), count * vec->element_size);
+	}
+
+	vec->count += count;
+	return SUS_SUCCESS;
+}
+
+int ivector_insert_vector_at(ivector_t *vec, ivector_t *src, size_t index)
+{
+	if (!src) return SUS_INVALID_ARG;
+
+	return ivector_insert_range_at(vec, src, 0, src->count, index);
+}
+
+int ivector_remove_indices(ivector_t *vec, const size_t *indices, size_t count)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!count) return SUS_SUCCESS;
+	if (!indices) return SUS_INVALID_ARG;
+
+	//Checked up front so a bad list leaves the vector untouched
+	for (size_t i = 0; i < count; i++)
+	{
+		if (indices[i] >= vec->count) return SUS_INVALID_INDEX;
+		if (i && indices[i] <= indices[i - 1]) return SUS_INVALID_ARG;
+	}
+
+	//Each run of kept elements between two removed indices moves once
+	size_t write = indices[0];
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t run = indices[i] + 1, end = i + 1 < count ? indices[i + 1] : vec->count;
+		memmove(ADDR(vec, write), ADDR(vec, run), (end - run) * vec->element_size);
+		write += end - run;
+	}
+
+	vec->count = write;
+	return SUS_SUCCESS;
+}
+
 int ivector_clear(ivector_t *vec)
 {
 	if (!vec) return SUS_INVALID_ARG;
@@ -243,49 +407,382 @@ ivector_t *ivector_get_all(ivector_t *vec, int (*match)(void *, void *), void *a
 	if (!match) return NULL;
 
 	ivector_t *ret = ivector_create(vec->element_size);
+	if (!ret) return NULL;
 
-	for (size_t i = 0; i < vec->count; i++)
-		if (match(ADDR(vec, i), arg))
-			ivector_append(ret, ADDR(vec, i));
+	if (ivector_get_all_into(vec, match, arg, ret))
+	{
+		ivector_destroy(ret);
+		return NULL;
+	}
 
 	return ret;
 }
 
-size_t ivector_remove(ivector_t *vec, void *data)
+int ivector_get_all_into(ivector_t *vec, int (*match)(void *, void *), void *arg, ivector_t *out)
 {
 	if (!vec) return SUS_INVALID_ARG;
+	if (!match) return SUS_INVALID_ARG;
+	if (!out) return SUS_INVALID_ARG;
+	if (vec->element_size != out->element_size) return SUS_INCOMPATIBLE_IVECTORS;
+
+	for (size_t i = 0; i < vec->count; i++)
+	{
+		if (!match(ADDR(vec, i), arg)) continue;
+
+		int err = ivector_append(out, ADDR(vec, i));
+		if (err) return err;
+	}
+
+	return SUS_SUCCESS;
+}
+
+typedef struct
+{
+	void *data;
+	size_t size;
+} ivector_bytes_t;
+
+static int ivector_match_bytes(void *elem, void *arg)
+{
+	ivector_bytes_t *bytes = arg;
+	return memcmp(elem, bytes->data, bytes->size) == 0;
+}
 
-	size_t counter = 0;
+//Removes matching elements in a single pass, each run of kept elements moves with one memmove
+static size_t ivector_compact(ivector_t *vec, int (*match)(void *, void *), void *arg)
+{
+	size_t write = 0, run = 0;
 
-	for (size_t i = vec->count - 1; i < ~(size_t)0; i--)
+	for (size_t i = 0; i < vec->count; i++)
 	{
-		if (memcmp(ADDR(vec, i), data, vec->element_size) == 0)
-		{
-			ivector_remove_at(vec, i);
-			counter++;
-		}
+		if (!match(ADDR(vec, i), arg)) continue;
+
+		if (write != run)
+			memmove(ADDR(vec, write), ADDR(vec, run), (i - run) * vec->element_size);
+		write += i - run;
+		run = i + 1;
 	}
 
+	if (write != run)
+		memmove(ADDR(vec, write), ADDR(vec, run), (vec->count - run) * vec->element_size);
+	write += vec->count - run;
+
+	size_t counter = vec->count - write;
+	vec->count = write;
+
 	return counter;
 }
 
+size_t ivector_remove(ivector_t *vec, void *data)
+{
+	if (!vec) return SUS_INVALID_ARG;
+
+	ivector_bytes_t bytes = { data, vec->element_size };
+	return ivector_compact(vec, ivector_match_bytes, &bytes);
+}
+
 size_t ivector_remove_all(ivector_t *vec, int (*match)(void *, void *), void *arg)
 {
 	if (!vec) return SUS_INVALID_ARG;
 	if (!match) return SUS_INVALID_ARG;
 
-	size_t counter = 0;
+	return ivector_compact(vec, match, arg);
+}
+
+//Introsort: quicksort on median pivots, heapsort once too deep, insertion sort on small ranges
+#define IVECTOR_SORT_INSERTION 16
+//Moves a partial insertion sort may make before giving up on a range that looked sorted
+#define IVECTOR_SORT_PARTIAL_LIMIT 8
+
+#define AT(base, idx, size) ((char*)(base) + (idx) * (size))
+
+typedef struct
+{
+	char *data;
+	char *buf;
+	char *src;
+	char *dst;
+	size_t count;
+	size_t size;
+	size_t chunks;
+	size_t width;
+	int (*comparer)(void *, void *);
+	int stable;
+} ivector_sort_job_t;
+
+static inline void ivector_swap(char *a, char *b, size_t size)
+{
+	char tmp[64];
+
+	while (size)
+	{
+		size_t step = MIN(size, sizeof(tmp));
+		memcpy(tmp, a, step);
+		memcpy(a, b, step);
+		memcpy(b, tmp, step);
+		a += step;
+		b += step;
+		size -= step;
+	}
+}
+
+static inline void ivector_sort3(char *a, char *b, char *c, size_t size, int (*comparer)(void *, void *))
+{
+	if (comparer(b, a) < 0) ivector_swap(a, b, size);
+	if (comparer(c, b) < 0)
+	{
+		ivector_swap(b, c, size);
+		if (comparer(b, a) < 0) ivector_swap(a, b, size);
+	}
+}
+
+//Elements are bubbled down by swaps, avoids needing element_size bytes of scratch
+static void ivector_insertion_sort(char *data, size_t count, size_t size, int (*comparer)(void *, void *))
+{
+	for (size_t i = 1; i < count; i++)
+		for (size_t j = i; j > 0 && comparer(AT(data, j - 1, size), AT(data, j, size)) > 0; j--)
+			ivector_swap(AT(data, j - 1, size), AT(data, j, size), size);
+}
+
+//Returns SUS_TRUE if the range got sorted without exceeding IVECTOR_SORT_PARTIAL_LIMIT moves
+static int ivector_partial_insertion_sort(char *data, size_t count, size_t size, int (*comparer)(void *, void *))
+{
+	size_t moves = 0;
 
-	for (size_t i = vec->count - 1; i < ~(size_t)0; i--)
+	for (size_t i = 1; i < count; i++)
 	{
-		if (match(ADDR(vec, i), arg))
+		for (size_t j = i; j > 0 && comparer(AT(data, j - 1, size), AT(data, j, size)) > 0; j--)
 		{
-			ivector_remove_at(vec, i);
-			counter++;
+			ivector_swap(AT(data, j - 1, size), AT(data, j, size), size);
+			if (++moves > IVECTOR_SORT_PARTIAL_LIMIT) return SUS_FALSE;
 		}
 	}
 
-	return counter;
+	return SUS_TRUE;
+}
+
+static void ivector_sift_down(char *data, size_t root, size_t count, size_t size, int (*comparer)(void *, void *))
+{
+	for (;;)
+	{
+		size_t child = 2 * root + 1;
+		if (child >= count) break;
+		if (child + 1 < count && comparer(AT(data, child, size), AT(data, child + 1, size)) < 0) child++;
+		if (comparer(AT(data, root, size), AT(data, child, size)) >= 0) break;
+
+		ivector_swap(AT(data, root, size), AT(data, child, size), size);
+		root = child;
+	}
+}
+
+static void ivector_heap_sort(char *data, size_t count, size_t size, int (*comparer)(void *, void *))
+{
+	for (size_t i = count / 2; i-- > 0;)
+		ivector_sift_down(data, i, count, size, comparer);
+
+	for (size_t end = count - 1; end > 0; end--)
+	{
+		ivector_swap(data, AT(data, end, size), size);
+		ivector_sift_down(data, 0, end, size, comparer);
+	}
+}
+
+static void ivector_introsort(char *data, size_t count, size_t size, int (*comparer)(void *, void *), size_t depth)
+{
+	while (count > IVECTOR_SORT_INSERTION)
+	{
+		if (!depth--)
+		{
+			ivector_heap_sort(data, count, size, comparer);
+			return;
+		}
+
+		//Median of three, or pseudo median of nine on larger ranges, moved to the front as pivot
+		size_t mid = count / 2;
+		ivector_sort3(data, AT(data, mid, size), AT(data, count - 1, size), size, comparer);
+		if (count > 128)
+		{
+			ivector_sort3(AT(data, 1, size), AT(data, mid - 1, size), AT(data, count - 2, size), size, comparer);
+			ivector_sort3(AT(data, 2, size), AT(data, mid + 1, size), AT(data, count - 3, size), size, comparer);
+			ivector_sort3(AT(data, mid - 1, size), AT(data, mid, size), AT(data, mid + 1, size), size, comparer);
+		}
+		ivector_swap(data, AT(data, mid, size), size);
+
+		//Hoare partition, pivot stays at data[0] until the end so it can be compared in place
+		size_t i = 0, j = count;
+		int swapped = 0;
+
+		for (;;)
+		{
+			do i++; while (i < count && comparer(AT(data, i, size), data) < 0);
+			do j--; while (comparer(data, AT(data, j, size)) < 0);
+			if (i >= j) break;
+
+			ivector_swap(AT(data, i, size), AT(data, j, size), size);
+			swapped = 1;
+		}
+
+		ivector_swap(data, AT(data, j, size), size);
+
+		size_t left = j, right = count - j - 1;
+
+		//Nothing moved and the split is balanced, the input is likely (almost) sorted already
+		if (!swapped && MIN(left, right) >= count / 8
+			&& ivector_partial_insertion_sort(data, left, size, comparer)
+			&& ivector_partial_insertion_sort(AT(data, j + 1, size), right, size, comparer))
+			return;
+
+		//Recurse into the smaller side, loop on the larger one, keeps the stack logarithmic
+		if (left < right)
+		{
+			ivector_introsort(data, left, size, comparer, depth);
+			data = AT(data, j + 1, size);
+			count = right;
+		}
+		else
+		{
+			ivector_introsort(AT(data, j + 1, size), right, size, comparer, depth);
+			count = left;
+		}
+	}
+
+	ivector_insertion_sort(data, count, size, comparer);
+}
+
+static void ivector_unstable_sort(char *data, size_t count, size_t size, int (*comparer)(void *, void *))
+{
+	size_t depth = 0;
+	for (size_t n = count; n > 1; n >>= 1)
+		depth += 2;
+
+	ivector_introsort(data, count, size, comparer, depth);
+}
+
+//Equal elements take from a first, so merging keeps order
+static void ivector_merge(char *dst, char *a, size_t a_count, char *b, size_t b_count, size_t size, int (*comparer)(void *, void *))
+{
+	while (a_count && b_count)
+	{
+		if (comparer(b, a) < 0) { memcpy(dst, b, size); b += size; b_count--; }
+		else { memcpy(dst, a, size); a += size; a_count--; }
+		dst += size;
+	}
+
+	memcpy(dst, a, a_count * size);
+	memcpy(AT(dst, a_count, size), b, b_count * size);
+}
+
+//Bottom up merge sort over insertion sorted runs, buf must hold count elements
+static void ivector_merge_sort(char *data, char *buf, size_t count, size_t size, int (*comparer)(void *, void *))
+{
+	for (size_t i = 0; i < count; i += IVECTOR_SORT_INSERTION)
+		ivector_insertion_sort(AT(data, i, size), MIN(IVECTOR_SORT_INSERTION, count - i), size, comparer);
+
+	char *src = data, *dst = buf;
+
+	for (size_t width = IVECTOR_SORT_INSERTION; width < count; width <<= 1)
+	{
+		for (size_t i = 0; i < count; i += 2 * width)
+		{
+			size_t mid = MIN(i + width, count), end = MIN(i + 2 * width, count);
+
+			//Runs already in order are copied as is, makes sorted input linear
+			if (mid == end || comparer(AT(src, mid - 1, size), AT(src, mid, size)) <= 0)
+				memcpy(AT(dst, i, size), AT(src, i, size), (end - i) * size);
+			else
+				ivector_merge(AT(dst, i, size), AT(src, i, size), mid - i, AT(src, mid, size), end - mid, size, comparer);
+		}
+
+		char *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != data)
+		memcpy(data, src, count * size);
+}
+
+//Number of elements from a among the first k of merge(a, b)
+static size_t ivector_merge_split(size_t k, char *a, size_t a_count, char *b, size_t b_count, size_t size, int (*comparer)(void *, void *))
+{
+	size_t lo = k > b_count ? k - b_count : 0, hi = MIN(k, a_count);
+
+	while (lo < hi)
+	{
+		size_t i = lo + (hi - lo) / 2, j = k - i;
+
+		if (j > 0 && i < a_count && comparer(AT(a, i, size), AT(b, j - 1, size)) <= 0) lo = i + 1;
+		else hi = i;
+	}
+
+	return lo;
+}
+
+static inline size_t ivector_chunk_start(ivector_sort_job_t *job, size_t chunk)
+{
+	return job->count * MIN(chunk, job->chunks) / job->chunks;
+}
+
+static void ivector_sort_chunk(void *arg, size_t chunk)
+{
+	ivector_sort_job_t *job = arg;
+	size_t start = ivector_chunk_start(job, chunk), end = ivector_chunk_start(job, chunk + 1);
+
+	if (job->stable) ivector_merge_sort(AT(job->data, start, job->size), AT(job->buf, start, job->size), end - start, job->size, job->comparer);
+	else ivector_unstable_sort(AT(job->data, start, job->size), end - start, job->size, job->comparer);
+}
+
+//Each worker produces the output of one chunk, which lies inside a single pair of runs being merged
+static void ivector_merge_chunk(void *arg, size_t chunk)
+{
+	ivector_sort_job_t *job = arg;
+	size_t first = chunk / (2 * job->width) * 2 * job->width;
+	size_t start = ivector_chunk_start(job, first);
+	size_t mid = ivector_chunk_start(job, first + job->width);
+	size_t end = ivector_chunk_start(job, first + 2 * job->width);
+	size_t k0 = ivector_chunk_start(job, chunk) - start, k1 = ivector_chunk_start(job, chunk + 1) - start;
+
+	char *a = AT(job->src, start, job->size), *b = AT(job->src, mid, job->size);
+	size_t i0 = ivector_merge_split(k0, a, mid - start, b, end - mid, job->size, job->comparer);
+	size_t i1 = ivector_merge_split(k1, a, mid - start, b, end - mid, job->size, job->comparer);
+
+	ivector_merge(AT(job->dst, start + k0, job->size), AT(a, i0, job->size), i1 - i0,
+		AT(b, k0 - i0, job->size), (k1 - i1) - (k0 - i0), job->size, job->comparer);
+}
+
+//Sorts one chunk per CPU, then merges pairs of runs with every CPU busy on every round
+static int ivector_parallel_sort(char *data, size_t count, size_t size, int (*comparer)(void *, void *), int stable)
+{
+	ivector_sort_job_t job;
+	job.buf = malloc(count * size);
+	if (!job.buf) return SUS_FAILED_ALLOC;
+
+	job.data = data;
+	job.count = count;
+	job.size = size;
+	job.chunks = workers_count();
+	job.comparer = comparer;
+	job.stable = stable;
+
+	workers_run(job.chunks, ivector_sort_chunk, &job);
+
+	job.src = data;
+	job.dst = job.buf;
+
+	for (job.width = 1; job.width < job.chunks; job.width <<= 1)
+	{
+		workers_run(job.chunks, ivector_merge_chunk, &job);
+
+		char *tmp = job.src;
+		job.src = job.dst;
+		job.dst = tmp;
+	}
+
+	if (job.src != data)
+		memcpy(data, job.src, count * size);
+
+	free(job.buf);
+	return SUS_SUCCESS;
 }
 
 ivector_t *ivector_sort(ivector_t *vec, int (*comparer)(void *, void *))
@@ -293,19 +790,686 @@ ivector_t *ivector_sort(ivector_t *vec, int (*comparer)(void *, void *))
 	if (!vec) return NULL;
 	if (!comparer) return NULL;
 
-	for (size_t gap = vec->count / 2; gap > 0; gap >>= 1)
+	if (vec->count >= IVECTOR_SORT_PARALLEL_MIN && workers_count() > 1
+		&& ivector_parallel_sort(vec->data, vec->count, vec->element_size, comparer, 0) == SUS_SUCCESS)
+		return vec;
+
+	ivector_unstable_sort(vec->data, vec->count, vec->element_size, comparer);
+
+	return vec;
+}
+
+ivector_t *ivector_sort_stable(ivector_t *vec, int (*comparer)(void *, void *))
+{
+	if (!vec) return NULL;
+	if (!comparer) return NULL;
+
+	if (vec->count <= IVECTOR_SORT_INSERTION)
+	{
+		ivector_insertion_sort(vec->data, vec->count, vec->element_size, comparer);
+		return vec;
+	}
+
+	if (vec->count >= IVECTOR_SORT_PARALLEL_MIN && workers_count() > 1)
+		return ivector_parallel_sort(vec->data, vec->count, vec->element_size, comparer, 1) ? NULL : vec;
+
+	void *buf = malloc(vec->count * vec->element_size);
+	if (!buf) return NULL;
+
+	ivector_merge_sort(vec->data, buf, vec->count, vec->element_size, comparer);
+	free(buf);
+
+	return vec;
+}
+
+#define IVECTOR_RADIX_BUCKETS 256
+
+typedef struct
+{
+	char *src;
+	char *dst;
+	size_t count;
+	size_t size;
+	size_t key_offset;
+	size_t key_width;
+	int flags;
+	size_t chunks;
+	size_t digit;
+	//Per chunk counts of every digit value, [chunk][digit][bucket], then scatter positions [chunk][bucket]
+	size_t *hists;
+	size_t *offsets;
+} ivector_radix_job_t;
+
+//Key bits mapped so that unsigned order matches the order of the original type
+static inline uint64_t ivector_radix_key(const char *elem, size_t width, int flags)
+{
+	uint64_t key;
+
+	switch (width)
+	{
+		case 1: { uint8_t v; memcpy(&v, elem, 1); key = v; break; }
+		case 2: { uint16_t v; memcpy(&v, elem, 2); key = v; break; }
+		case 4: { uint32_t v; memcpy(&v, elem, 4); key = v; break; }
+		default: { uint64_t v; memcpy(&v, elem, 8); key = v; break; }
+	}
+
+	uint64_t sign = (uint64_t)1 << (width * 8 - 1);
+
+	//Negative floats sort by reversed magnitude, positives just go above them
+	if (flags & IVECTOR_RADIX_FLOAT) key = (key & sign) ? ~key : key | sign;
+	else if (flags & IVECTOR_RADIX_SIGNED) key ^= sign;
+
+	return key;
+}
+
+static inline void ivector_radix_copy(char *dst, const char *src, size_t size)
+{
+	switch (size)
+	{
+		case 4: memcpy(dst, src, 4); break;
+		case 8: memcpy(dst, src, 8); break;
+		case 16: memcpy(dst, src, 16); break;
+		default: memcpy(dst, src, size); break;
+	}
+}
+
+static inline size_t ivector_radix_chunk_start(ivector_radix_job_t *job, size_t chunk)
+{
+	return job->count * chunk / job->chunks;
+}
+
+static void ivector_radix_count_all(void *arg, size_t chunk)
+{
+	ivector_radix_job_t *job = arg;
+	size_t *hist = &job->hists[chunk * job->key_width * IVECTOR_RADIX_BUCKETS];
+	size_t start = ivector_radix_chunk_start(job, chunk), end = ivector_radix_chunk_start(job, chunk + 1);
+	char *src = job->src;
+	size_t size = job->size, key_offset = job->key_offset, width = job->key_width;
+	int flags = job->flags;
+
+	for (size_t i = start; i < end; i++)
+	{
+		uint64_t key = ivector_radix_key(AT(src, i, size) + key_offset, width, flags);
+
+		for (size_t d = 0; d < width; d++)
+			hist[d * IVECTOR_RADIX_BUCKETS + ((key >> (d * 8)) & 0xFF)]++;
+	}
+}
+
+static void ivector_radix_count(void *arg, size_t chunk)
+{
+	ivector_radix_job_t *job = arg;
+	size_t *hist = &job->hists[(chunk * job->key_width + job->digit) * IVECTOR_RADIX_BUCKETS];
+	size_t end = ivector_radix_chunk_start(job, chunk + 1);
+	size_t shift = job->digit * 8;
+
+	memset(hist, 0, IVECTOR_RADIX_BUCKETS * sizeof(size_t));
+
+	for (size_t i = ivector_radix_chunk_start(job, chunk); i < end; i++)
+		hist[(ivector_radix_key(AT(job->src, i, job->size) + job->key_offset, job->key_width, job->flags) >> shift) & 0xFF]++;
+}
+
+static void ivector_radix_scatter(void *arg, size_t chunk)
+{
+	ivector_radix_job_t *job = arg;
+	size_t start = ivector_radix_chunk_start(job, chunk), end = ivector_radix_chunk_start(job, chunk + 1);
+
+	//Copied out of job, stores through char pointers would otherwise force reloading them every element
+	char *src = job->src, *dst = job->dst;
+	size_t size = job->size, width = job->key_width, key_offset = job->key_offset, shift = job->digit * 8;
+	int flags = job->flags;
+	size_t positions[IVECTOR_RADIX_BUCKETS];
+	memcpy(positions, &job->offsets[chunk * IVECTOR_RADIX_BUCKETS], sizeof(positions));
+
+	for (size_t i = start; i < end; i++)
+	{
+		char *elem = AT(src, i, size);
+		size_t bucket = (ivector_radix_key(elem + key_offset, width, flags) >> shift) & 0xFF;
+		ivector_radix_copy(AT(dst, positions[bucket]++, size), elem, size);
+	}
+}
+
+int ivector_radix_sort(ivector_t *vec, size_t key_offset, size_t key_width, int flags)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (key_width != 1 && key_width != 2 && key_width != 4 && key_width != 8) return SUS_INVALID_ARG;
+	if ((flags & IVECTOR_RADIX_FLOAT) && key_width != 4 && key_width != 8) return SUS_INVALID_ARG;
+	if (key_offset + key_width > vec->element_size) return SUS_INVALID_ARG;
+	if (vec->count < 2) return SUS_SUCCESS;
+
+	ivector_radix_job_t job;
+	job.count = vec->count;
+	job.size = vec->element_size;
+	job.key_offset = key_offset;
+	job.key_width = key_width;
+	job.flags = flags;
+	job.chunks = 1;
+
+	if ((flags & IVECTOR_RADIX_PARALLEL) && vec->count >= IVECTOR_SORT_PARALLEL_MIN)
+		job.chunks = workers_count();
+
+	char *buf = malloc(vec->count * vec->element_size);
+	job.hists = calloc(job.chunks * key_width * IVECTOR_RADIX_BUCKETS, sizeof(size_t));
+	job.offsets = malloc(job.chunks * IVECTOR_RADIX_BUCKETS * sizeof(size_t));
+	if (!buf || !job.hists || !job.offsets)
+	{
+		free(buf);
+		free(job.hists);
+		free(job.offsets);
+		return SUS_FAILED_ALLOC;
+	}
+
+	//One read of the data counts every digit, totals do not change as elements move between passes
+	job.src = vec->data;
+	job.dst = buf;
+	workers_run(job.chunks, ivector_radix_count_all, &job);
+
+	int permuted = 0;
+
+	for (job.digit = 0; job.digit < key_width; job.digit++)
 	{
-		for (size_t i = gap; i < vec->count; i++)
+		size_t totals[IVECTOR_RADIX_BUCKETS] = { 0 };
+		int trivial = 0;
+
+		for (size_t c = 0; c < job.chunks; c++)
+			for (size_t b = 0; b < IVECTOR_RADIX_BUCKETS; b++)
+				totals[b] += job.hists[(c * key_width + job.digit) * IVECTOR_RADIX_BUCKETS + b];
+
+		//Every element has the same digit, the pass would not reorder anything
+		for (size_t b = 0; b < IVECTOR_RADIX_BUCKETS && !trivial; b++)
+			trivial = totals[b] == job.count;
+		if (trivial) continue;
+
+		//Chunk counts from the first read are stale once elements moved
+		if (permuted && job.chunks > 1)
+			workers_run(job.chunks, ivector_radix_count, &job);
+
+		//Chunk c writes each bucket after all of that bucket's elements from earlier chunks, keeps the sort stable
+		size_t position = 0;
+		for (size_t b = 0; b < IVECTOR_RADIX_BUCKETS; b++)
 		{
-			void *tmp = ADDR(vec, i);
+			for (size_t c = 0; c < job.chunks; c++)
+			{
+				job.offsets[c * IVECTOR_RADIX_BUCKETS + b] = position;
+				position += job.hists[(c * key_width + job.digit) * IVECTOR_RADIX_BUCKETS + b];
+			}
+		}
+
+		workers_run(job.chunks, ivector_radix_scatter, &job);
+
+		char *tmp = job.src;
+		job.src = job.dst;
+		job.dst = tmp;
+		permuted = 1;
+	}
+
+	if (job.src != (char *)vec->data)
+		memcpy(vec->data, job.src, vec->count * vec->element_size);
+
+	free(buf);
+	free(job.hists);
+	free(job.offsets);
+
+	return SUS_SUCCESS;
+}
+
+typedef struct
+{
+	char *data;
+	size_t size;
+	size_t count;
+	size_t grain;
+	void *arg;
+	void (*func)(void *, void *);
+	int (*match)(void *, void *);
+	void (*map)(void *, void *, void *);
+	void (*fold)(void *, void *, void *);
+	unsigned char *matched;
+	size_t *offsets;
+	char *out;
+	char *mapped;
+	size_t mapped_size;
+	char *accs;
+	size_t acc_size;
+	void *identity;
+} ivector_parallel_job_t;
+
+//Fills the fields every parallel job uses, returns the number of chunks
+static size_t ivector_parallel_setup(ivector_parallel_job_t *job, ivector_t *vec, void *arg, size_t grain)
+{
+	job->data = vec->data;
+	job->size = vec->element_size;
+	job->count = vec->count;
+	job->grain = grain ? grain : PARALLEL_DEFAULT_GRAIN;
+	job->arg = arg;
+
+	return DIV_CEIL(job->count, job->grain);
+}
+
+static void ivector_parallel_iterate_chunk(void *arg, size_t chunk)
+{
+	ivector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count);
+
+	for (size_t i = start; i < end; i++)
+		job->func(AT(job->data, i, job->size), job->arg);
+}
+
+int ivector_parallel_iterate(ivector_t *vec, void (*func)(void *, void *), void *arg, size_t grain)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!func) return SUS_INVALID_ARG;
+
+	ivector_parallel_job_t job;
+	size_t chunks = ivector_parallel_setup(&job, vec, arg, grain);
+	job.func = func;
+
+	workers_run(chunks, ivector_parallel_iterate_chunk, &job);
+
+	return SUS_SUCCESS;
+}
+
+//First pass of the filter, every chunk records which of its elements matched and how many did
+static void ivector_parallel_match_chunk(void *arg, size_t chunk)
+{
+	ivector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count), matches = 0;
+
+	for (size_t i = start; i < end; i++)
+		matches += job->matched[i] = job->match(AT(job->data, i, job->size), job->arg) ? 1 : 0;
+
+	job->offsets[chunk] = matches;
+}
+
+//Second pass, offsets now hold where each chunk starts writing so the matches keep their order
+static void ivector_parallel_gather_chunk(void *arg, size_t chunk)
+{
+	ivector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count), write = job->offsets[chunk];
+
+	for (size_t i = start; i < end; i++)
+		if (job->matched[i])
+			memcpy(AT(job->out, write++, job->size), AT(job->data, i, job->size), job->size);
+}
+
+int ivector_parallel_filter(ivector_t *vec, int (*match)(void *, void *), void *arg, ivector_t *out, size_t grain)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!match) return SUS_INVALID_ARG;
+	if (!out || out == vec) return SUS_INVALID_ARG;
+	if (vec->element_size != out->element_size) return SUS_INCOMPATIBLE_IVECTORS;
+
+	ivector_parallel_job_t job;
+	size_t chunks = ivector_parallel_setup(&job, vec, arg, grain);
+	job.match = match;
+
+	if (chunks <= 1) return ivector_get_all_into(vec, match, arg, out);
+
+	job.matched = malloc(job.count);
+	job.offsets = malloc(chunks * sizeof(size_t));
+	if (!job.matched || !job.offsets)
+	{
+		free(job.matched);
+		free(job.offsets);
+		return SUS_FAILED_ALLOC;
+	}
+
+	workers_run(chunks, ivector_parallel_match_chunk, &job);
+
+	size_t total = 0;
+	for (size_t i = 0; i < chunks; i++)
+	{
+		size_t matches = job.offsets[i];
+		job.offsets[i] = total;
+		total += matches;
+	}
+
+	int err = ivector_ensure(out, out->count + total);
+	if (!err)
+	{
+		job.out = ADDR(out, out->count);
+		workers_run(chunks, ivector_parallel_gather_chunk, &job);
+		out->count += total;
+	}
+
+	free(job.matched);
+	free(job.offsets);
+	return err;
+}
+
+static void ivector_parallel_map_chunk(void *arg, size_t chunk)
+{
+	ivector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count);
+
+	for (size_t i = start; i < end; i++)
+		job->map(AT(job->data, i, job->size), job->mapped + i * job->mapped_size, job->arg);
+}
+
+int ivector_parallel_map(ivector_t *vec, void (*func)(void *, void *, void *), void *arg, ivector_t *out, size_t grain)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!func) return SUS_INVALID_ARG;
+	if (!out) return SUS_INVALID_ARG;
+
+	int err = ivector_ensure(out, out->count + vec->count);
+	if (err) return err;
+
+	ivector_parallel_job_t job;
+	size_t chunks = ivector_parallel_setup(&job, vec, arg, grain);
+	job.map = func;
+	job.mapped = ADDR(out, out->count);
+	job.mapped_size = out->element_size;
+
+	workers_run(chunks, ivector_parallel_map_chunk, &job);
+	out->count += vec->count;
+
+	return SUS_SUCCESS;
+}
+
+static void ivector_parallel_fold_chunk(void *arg, size_t chunk)
+{
+	ivector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count);
+	char *acc = job->accs + chunk * job->acc_size;
+
+	memcpy(acc, job->identity, job->acc_size);
+	for (size_t i = start; i < end; i++)
+		job->fold(acc, AT(job->data, i, job->size), job->arg);
+}
+
+int ivector_parallel_reduce(ivector_t *vec, void (*fold)(void *, void *, void *), void (*combine)(void *, void *, void *), void *acc, size_t acc_size, void *arg, size_t grain)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!fold || !combine) return SUS_INVALID_ARG;
+	if (!acc) return SUS_INVALID_ARG;
 
-			size_t j;
-			for (j = i; j >= gap && comparer(ADDR(vec, j - gap), tmp) > 0; j -= gap)
-				memcpy(ADDR(vec, j), ADDR(vec, j - gap), vec->element_size);
+	ivector_parallel_job_t job;
+	size_t chunks = ivector_parallel_setup(&job, vec, arg, grain);
+	job.fold = fold;
 
-			memcpy(ADDR(vec, j), tmp, vec->element_size);
+	if (chunks <= 1)
+	{
+		for (size_t i = 0; i < job.count; i++)
+			fold(acc, AT(job.data, i, job.size), arg);
+		return SUS_SUCCESS;
+	}
+
+	job.accs = malloc(chunks * acc_size);
+	if (!job.accs) return SUS_FAILED_ALLOC;
+	job.acc_size = acc_size;
+	job.identity = acc;
+
+	workers_run(chunks, ivector_parallel_fold_chunk, &job);
+
+	//Combined in chunk order, so combine only has to be associative
+	for (size_t i = 0; i < chunks; i++)
+		combine(acc, job.accs + i * acc_size, arg);
+
+	free(job.accs);
+	return SUS_SUCCESS;
+}
+
+//Sorted vectors, comparer(elem, key) must order elements the same way the vector was sorted
+
+#define IVECTOR_SET_UNION 0
+#define IVECTOR_SET_INTERSECT 1
+#define IVECTOR_SET_DIFFERENCE 2
+
+//Halves the range without branching on the comparison, the step compiles to a conditional move
+//upper of 0 finds the first element not below key, 1 the first element above it
+static size_t ivector_bound(char *data, size_t count, size_t size, void *key, int (*comparer)(void *, void *), int upper)
+{
+	if (!count) return 0;
+
+	size_t base = 0;
+
+	while (count > 1)
+	{
+		size_t half = count / 2;
+		base = comparer(AT(data, base + half, size), key) < upper ? base + half : base;
+		count -= half;
+	}
+
+	return base + (comparer(AT(data, base, size), key) < upper);
+}
+
+size_t ivector_lower_bound(ivector_t *vec, void *key, int (*comparer)(void *, void *))
+{
+	if (!vec) return 0;
+	if (!comparer) return 0;
+
+	return ivector_bound(vec->data, vec->count, vec->element_size, key, comparer, 0);
+}
+
+size_t ivector_upper_bound(ivector_t *vec, void *key, int (*comparer)(void *, void *))
+{
+	if (!vec) return 0;
+	if (!comparer) return 0;
+
+	return ivector_bound(vec->data, vec->count, vec->element_size, key, comparer, 1);
+}
+
+int ivector_binary_search(ivector_t *vec, void *key, int (*comparer)(void *, void *), size_t *index)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+
+	size_t i = ivector_bound(vec->data, vec->count, vec->element_size, key, comparer, 0);
+	if (index) *index = i;
+
+	return i < vec->count && !comparer(ADDR(vec, i), key) ? SUS_TRUE : SUS_FALSE;
+}
+
+int ivector_insert_sorted(ivector_t *vec, void *data, int (*comparer)(void *, void *))
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+
+	int err = ivector_ensure(vec, vec->count + 1);
+	if (err) return err;
+
+	return ivector_insert_at(vec, data, ivector_bound(vec->data, vec->count, vec->element_size, data, comparer, 1));
+}
+
+int ivector_insert_sorted_unique(ivector_t *vec, void *data, int (*comparer)(void *, void *), int *inserted)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+
+	size_t i = ivector_bound(vec->data, vec->count, vec->element_size, data, comparer, 0);
+
+	if (i < vec->count && !comparer(ADDR(vec, i), data))
+	{
+		if (inserted) *inserted = SUS_FALSE;
+		return SUS_SUCCESS;
+	}
+
+	int err = ivector_ensure(vec, vec->count + 1);
+	if (err) return err;
+
+	if (inserted) *inserted = SUS_TRUE;
+	return ivector_insert_at(vec, data, i);
+}
+
+size_t ivector_unique(ivector_t *vec, int (*comparer)(void *, void *))
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+	if (vec->count < 2) return 0;
+
+	size_t kept = 1;
+
+	for (size_t i = 1; i < vec->count; i++)
+	{
+		if (!comparer(ADDR(vec, kept - 1), ADDR(vec, i))) continue;
+
+		if (kept != i) memcpy(ADDR(vec, kept), ADDR(vec, i), vec->element_size);
+		kept++;
+	}
+
+	size_t counter = vec->count - kept;
+	vec->count = kept;
+
+	return counter;
+}
+
+//Single merge pass shared by the set operations, out is grown once up front
+static int ivector_set_op(ivector_t *a, ivector_t *b, int (*comparer)(void *, void *), ivector_t *out, int op)
+{
+	if (!a || !b) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+	if (!out || out == a || out == b) return SUS_INVALID_ARG;
+	if (a->element_size != b->element_size || a->element_size != out->element_size) return SUS_INCOMPATIBLE_IVECTORS;
+
+	size_t most = op == IVECTOR_SET_UNION ? a->count + b->count : (op == IVECTOR_SET_INTERSECT ? MIN(a->count, b->count) : a->count);
+	int err = ivector_ensure(out, out->count + most);
+	if (err) return err;
+
+	size_t size = out->element_size, i = 0, j = 0, write = 0;
+	char *dst = ADDR(out, out->count);
+
+	while (i < a->count && j < b->count)
+	{
+		int cmp = comparer(ADDR(a, i), ADDR(b, j));
+
+		if (cmp < 0)
+		{
+			if (op != IVECTOR_SET_INTERSECT) memcpy(AT(dst, write++, size), ADDR(a, i), size);
+			i++;
+		}
+		else if (cmp > 0)
+		{
+			if (op == IVECTOR_SET_UNION) memcpy(AT(dst, write++, size), ADDR(b, j), size);
+			j++;
+		}
+		else
+		{
+			if (op != IVECTOR_SET_DIFFERENCE) memcpy(AT(dst, write++, size), ADDR(a, i), size);
+			i++;
+			j++;
 		}
 	}
 
-	return vec;
+	if (op != IVECTOR_SET_INTERSECT)
+	{
+		memcpy(AT(dst, write, size), ADDR(a, i), (a->count - i) * size);
+		write += a->count - i;
+	}
+
+	if (op == IVECTOR_SET_UNION)
+	{
+		memcpy(AT(dst, write, size), ADDR(b, j), (b->count - j) * size);
+		write += b->count - j;
+	}
+
+	out->count += write;
+	return SUS_SUCCESS;
+}
+
+int ivector_set_union(ivector_t *a, ivector_t *b, int (*comparer)(void *, void *), ivector_t *out)
+{
+	return ivector_set_op(a, b, comparer, out, IVECTOR_SET_UNION);
+}
+
+int ivector_set_intersect(ivector_t *a, ivector_t *b, int (*comparer)(void *, void *), ivector_t *out)
+{
+	return ivector_set_op(a, b, comparer, out, IVECTOR_SET_INTERSECT);
+}
+
+int ivector_set_difference(ivector_t *a, ivector_t *b, int (*comparer)(void *, void *), ivector_t *out)
+{
+	return ivector_set_op(a, b, comparer, out, IVECTOR_SET_DIFFERENCE);
+}
+
+typedef struct
+{
+	ivector_t **srcs;
+	size_t *pos;
+	size_t *heap;
+	size_t size;
+	int (*comparer)(void *, void *);
+} ivector_kmerge_t;
+
+//Ties go to the lower source so the merge is stable
+static inline int ivector_kmerge_less(ivector_kmerge_t *merge, size_t x, size_t y)
+{
+	int cmp = merge->comparer(ADDR(merge->srcs[x], merge->pos[x]), ADDR(merge->srcs[y], merge->pos[y]));
+	return cmp < 0 || (!cmp && x < y);
+}
+
+static void ivector_kmerge_sift_down(ivector_kmerge_t *merge, size_t root)
+{
+	size_t *heap = merge->heap, tmp = heap[root];
+
+	for (;;)
+	{
+		size_t child = 2 * root + 1;
+		if (child >= merge->size) break;
+		if (child + 1 < merge->size && ivector_kmerge_less(merge, heap[child + 1], heap[child])) child++;
+		if (!ivector_kmerge_less(merge, heap[child], tmp)) break;
+
+		heap[root] = heap[child];
+		root = child;
+	}
+
+	heap[root] = tmp;
+}
+
+int ivector_merge_sorted(ivector_t **srcs, size_t count, int (*comparer)(void *, void *), ivector_t *out)
+{
+	if (!srcs && count) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+	if (!out) return SUS_INVALID_ARG;
+
+	size_t total = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!srcs[i] || srcs[i] == out) return SUS_INVALID_ARG;
+		if (srcs[i]->element_size != out->element_size) return SUS_INCOMPATIBLE_IVECTORS;
+		total += srcs[i]->count;
+	}
+
+	int err = ivector_ensure(out, out->count + total);
+	if (err) return err;
+
+	ivector_kmerge_t merge;
+	merge.srcs = srcs;
+	merge.comparer = comparer;
+	merge.size = 0;
+	merge.pos = calloc(2 * count + 1, sizeof(size_t));
+	if (!merge.pos) return SUS_FAILED_ALLOC;
+	merge.heap = merge.pos + count;
+
+	for (size_t i = 0; i < count; i++)
+		if (srcs[i]->count)
+			merge.heap[merge.size++] = i;
+
+	for (size_t i = merge.size / 2; i-- > 0;)
+		ivector_kmerge_sift_down(&merge, i);
+
+	size_t size = out->element_size;
+	char *dst = ADDR(out, out->count);
+
+	//The smallest head is always on top of the heap, the last source left is copied as a block
+	while (merge.size > 1)
+	{
+		size_t src = merge.heap[0];
+		memcpy(dst, ADDR(srcs[src], merge.pos[src]++), size);
+		dst += size;
+
+		if (merge.pos[src] == srcs[src]->count)
+			merge.heap[0] = merge.heap[--merge.size];
+		ivector_kmerge_sift_down(&merge, 0);
+	}
+
+	if (merge.size)
+	{
+		size_t src = merge.heap[0];
+		memcpy(dst, ADDR(srcs[src], merge.pos[src]), (srcs[src]->count - merge.pos[src]) * size);
+	}
+
+	out->count += total;
+	free(merge.pos);
+	return SUS_SUCCESS;
 }
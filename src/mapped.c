@@ -0,0 +1,100 @@
+//mremap is a GNU extension
+#define _GNU_SOURCE
+
+#include "mapped.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "math_utils.h"
+
+
+
+static size_t mapped_page(void)
+{
+	static size_t page = 0;
+
+	if (!page)
+	{
+		long size = sysconf(_SC_PAGESIZE);
+		page = size < 1 ? 4096 : (size_t)size;
+	}
+
+	return page;
+}
+
+//Transparent huge pages are only a hint, failing to get them is not an error
+static void mapped_advise(void *ptr, size_t bytes, int huge)
+{
+#ifdef MADV_HUGEPAGE
+	if (huge) madvise(ptr, mapped_size(bytes), MADV_HUGEPAGE);
+#else
+	(void)ptr;
+	(void)bytes;
+	(void)huge;
+#endif
+}
+
+size_t mapped_size(size_t bytes)
+{
+	size_t page = mapped_page();
+	return DIV_CEIL(bytes, page) * page;
+}
+
+size_t mapped_capacity(size_t capacity, size_t size)
+{
+	size_t length = mapped_size(capacity * size), fill = length / size;
+
+	//Elements bigger than a page can leave fill * size whole pages short of length, keep the exact count then
+	return fill > capacity && mapped_size(fill * size) == length ? fill : capacity;
+}
+
+void *mapped_alloc(size_t bytes, int huge)
+{
+	void *ret = mmap(NULL, mapped_size(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ret == MAP_FAILED) return NULL;
+
+	mapped_advise(ret, bytes, huge);
+	return ret;
+}
+
+void *mapped_realloc(void *ptr, size_t old_bytes, size_t bytes, int huge)
+{
+	size_t old_size = mapped_size(old_bytes), size = mapped_size(bytes);
+	if (old_size == size) return ptr;
+
+#ifdef MREMAP_MAYMOVE
+	void *ret = mremap(ptr, old_size, size, MREMAP_MAYMOVE);
+	if (ret == MAP_FAILED) return NULL;
+#else
+	void *ret = mapped_alloc(bytes, 0);
+	if (!ret) return NULL;
+
+	memcpy(ret, ptr, MIN(old_size, size));
+	munmap(ptr, old_size);
+#endif
+
+	mapped_advise(ret, bytes, huge);
+	return ret;
+}
+
+void mapped_free(void *ptr, size_t bytes)
+{
+	if (ptr) munmap(ptr, mapped_size(bytes));
+}
+
+void mapped_release(void *ptr, size_t bytes)
+{
+#ifdef MADV_DONTNEED
+	size_t page = mapped_page();
+	uintptr_t begin = DIV_CEIL((uintptr_t)ptr, page) * page, end = ((uintptr_t)ptr + bytes) / page * page;
+
+	if (end > begin) madvise((void *)begin, end - begin, MADV_DONTNEED);
+#else
+	(void)ptr;
+	(void)bytes;
+#endif
+}
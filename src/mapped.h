@@ -0,0 +1,23 @@
+#ifndef SUS_MAPPED_H_
+#define SUS_MAPPED_H_
+
+#include <stddef.h>
+
+//Internal helpers for buffers big enough to be mapped directly, not installed
+
+//Bytes actually mapped to hold bytes, a whole number of pages
+size_t mapped_size(size_t bytes);
+//Elements of size bytes that fill the mapping made for capacity of them
+//The result always maps back to the same length, so callers can recompute the length from it alone
+size_t mapped_capacity(size_t capacity, size_t size);
+//Private anonymous mapping of mapped_size(bytes), NULL on failure
+void *mapped_alloc(size_t bytes, int huge);
+//Resizes a mapping from mapped_alloc, pages are moved rather than copied where the system allows
+//NULL on failure, in which case the old mapping is left intact
+void *mapped_realloc(void *ptr, size_t old_bytes, size_t bytes, int huge);
+void mapped_free(void *ptr, size_t bytes);
+//Gives the whole pages inside [ptr, ptr + bytes) back to the system, they read as zero if touched again
+//Works on any writable memory, eg: the already consumed part of a large malloc block
+void mapped_release(void *ptr, size_t bytes);
+
+#endif
@@ -0,0 +1,345 @@
+#include "ohashtable.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "sus.h"
+#include "fmix.h"
+#include "vector.h"
+#include "math_utils.h"
+
+
+
+//Control bytes: full slots hold the low 7 bits of their hash, free slots have the high bit set
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xFE)
+#define CTRL_IS_FULL(c) (!((c) & 0x80))
+
+//Slots are probed one group at a time, capacity is always a power of two multiple of the group width
+#define OHASHTABLE_GROUP 16
+#define OHASHTABLE_DEFAULT_CAP 64
+//Max load of 7/8, counting tombstones
+#define OHASHTABLE_MAX_FILL(cap) ((cap) - ((cap) >> 3))
+
+typedef struct
+{
+	size_t hash;
+	void *key;
+	void *value;
+} ohashtable_slot_t;
+
+struct ohashtable_t
+{
+	uint8_t *ctrl;
+	ohashtable_slot_t *slots;
+	size_t capacity;
+	size_t count;
+	size_t growth_left;
+	size_t (*hasher)(void*);
+	int (*comparer)(void*, void*);
+};
+
+
+
+#ifdef __SSE2__
+static inline uint32_t group_match(const uint8_t *ctrl, uint8_t value)
+{
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+}
+
+static inline uint32_t group_match_free(const uint8_t *ctrl)
+{
+	//Empty and deleted both have the high bit set, which is exactly what movemask extracts
+	return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+#else
+static inline uint32_t group_match(const uint8_t *ctrl, uint8_t value)
+{
+	uint32_t mask = 0;
+
+	for (int i = 0; i < OHASHTABLE_GROUP; i++)
+		mask |= (uint32_t)(ctrl[i] == value) << i;
+
+	return mask;
+}
+
+static inline uint32_t group_match_free(const uint8_t *ctrl)
+{
+	uint32_t mask = 0;
+
+	for (int i = 0; i < OHASHTABLE_GROUP; i++)
+		mask |= (uint32_t)(ctrl[i] >> 7) << i;
+
+	return mask;
+}
+#endif
+
+//User hashers may be weak (eg: hash_ptr), both the group index and the control byte need well mixed bits
+//Returns the slot index holding key, or capacity if not found
+static size_t ohashtable_find(ohashtable_t *table, void *key, size_t hash)
+{
+	size_t group_mask = table->capacity / OHASHTABLE_GROUP - 1;
+	size_t group = (hash >> 7) & group_mask;
+	uint8_t h2 = hash & 0x7F;
+
+	//Triangular probing visits every group once when the group count is a power of two
+	for (size_t step = 1; step <= group_mask + 1; step++)
+	{
+		const uint8_t *ctrl = &table->ctrl[group * OHASHTABLE_GROUP];
+
+		for (uint32_t match = group_match(ctrl, h2); match; match &= match - 1)
+		{
+			size_t index = group * OHASHTABLE_GROUP + __builtin_ctz(match);
+			ohashtable_slot_t *slot = &table->slots[index];
+
+			if (slot->hash == hash && !table->comparer(key, slot->key))
+				return index;
+		}
+
+		if (group_match(ctrl, CTRL_EMPTY))
+			break;
+
+		group = (group + step) & group_mask;
+	}
+
+	return table->capacity;
+}
+
+//Returns the first empty or deleted slot in the probe sequence of hash
+static size_t ohashtable_find_free(uint8_t *ctrls, size_t capacity, size_t hash)
+{
+	size_t group_mask = capacity / OHASHTABLE_GROUP - 1;
+	size_t group = (hash >> 7) & group_mask;
+
+	for (size_t step = 1; ; step++)
+	{
+		uint32_t match = group_match_free(&ctrls[group * OHASHTABLE_GROUP]);
+		if (match)
+			return group * OHASHTABLE_GROUP + __builtin_ctz(match);
+
+		group = (group + step) & group_mask;
+	}
+}
+
+static int ohashtable_rehash(ohashtable_t *table, size_t capacity)
+{
+	uint8_t *ctrl = malloc(capacity);
+	if (!ctrl) return SUS_FAILED_ALLOC;
+
+	ohashtable_slot_t *slots = malloc(capacity * sizeof(ohashtable_slot_t));
+	if (!slots) { free(ctrl); return SUS_FAILED_ALLOC; }
+
+	memset(ctrl, CTRL_EMPTY, capacity);
+
+	//Stored hashes are reused, the hasher is never called during a rehash
+	for (size_t i = 0; i < table->capacity; i++)
+	{
+		if (!CTRL_IS_FULL(table->ctrl[i])) continue;
+
+		ohashtable_slot_t *slot = &table->slots[i];
+		size_t index = ohashtable_find_free(ctrl, capacity, slot->hash);
+		ctrl[index] = slot->hash & 0x7F;
+		slots[index] = *slot;
+	}
+
+	free(table->ctrl);
+	free(table->slots);
+	table->ctrl = ctrl;
+	table->slots = slots;
+	table->capacity = capacity;
+	table->growth_left = OHASHTABLE_MAX_FILL(capacity) - table->count;
+
+	return SUS_SUCCESS;
+}
+
+ohashtable_t *ohashtable_create(size_t (*hasher)(void*), int (*comparer)(void*, void*))
+{
+	if (!hasher) return NULL;
+	if (!comparer) return NULL;
+
+	ohashtable_t *table = malloc(sizeof(ohashtable_t));
+	if (!table) return NULL;
+
+	table->ctrl = malloc(OHASHTABLE_DEFAULT_CAP);
+	if (!table->ctrl) { free(table); return NULL; }
+
+	table->slots = malloc(OHASHTABLE_DEFAULT_CAP * sizeof(ohashtable_slot_t));
+	if (!table->slots) { free(table->ctrl); free(table); return NULL; }
+
+	memset(table->ctrl, CTRL_EMPTY, OHASHTABLE_DEFAULT_CAP);
+
+	table->capacity = OHASHTABLE_DEFAULT_CAP;
+	table->count = 0;
+	table->growth_left = OHASHTABLE_MAX_FILL(OHASHTABLE_DEFAULT_CAP);
+	table->hasher = hasher;
+	table->comparer = comparer;
+
+	return table;
+}
+
+int ohashtable_destroy(ohashtable_t *table)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	free(table->ctrl);
+	free(table->slots);
+	free(table);
+
+	return SUS_SUCCESS;
+}
+
+int ohashtable_destroy_free(ohashtable_t *table, void (*free_key)(void *), void (*free_value)(void *))
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	for (size_t i = 0; i < table->capacity; i++)
+	{
+		if (!CTRL_IS_FULL(table->ctrl[i])) continue;
+
+		if (free_key) free_key(table->slots[i].key);
+		if (free_value) free_value(table->slots[i].value);
+	}
+
+	return ohashtable_destroy(table);
+}
+
+int ohashtable_add(ohashtable_t *table, void *key, void *value)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	if (!table->growth_left)
+	{
+		//Only grow if live entries need it, otherwise just clear out tombstones
+		size_t capacity = table->count >= OHASHTABLE_MAX_FILL(table->capacity) >> 1 ? table->capacity << 1 : table->capacity;
+		int err = ohashtable_rehash(table, capacity);
+		if (err) return err;
+	}
+
+	size_t hash = (size_t)hash_fmix64(table->hasher(key));
+	size_t index = ohashtable_find_free(table->ctrl, table->capacity, hash);
+
+	if (table->ctrl[index] == CTRL_EMPTY)
+		table->growth_left--;
+
+	table->ctrl[index] = hash & 0x7F;
+	table->slots[index].hash = hash;
+	table->slots[index].key = key;
+	table->slots[index].value = value;
+	table->count++;
+
+	return SUS_SUCCESS;
+}
+
+void *ohashtable_get(ohashtable_t *table, void *key)
+{
+	if (!table) return NULL;
+
+	size_t index = ohashtable_find(table, key, (size_t)hash_fmix64(table->hasher(key)));
+
+	return index != table->capacity ? table->slots[index].value : NULL;
+}
+
+int ohashtable_remove(ohashtable_t *table, void *key, void **removed_key, void **removed_content)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	size_t index = ohashtable_find(table, key, (size_t)hash_fmix64(table->hasher(key)));
+
+	if (index == table->capacity)
+		return SUS_ENTRY_NOT_FOUND;
+
+	if (removed_key) *removed_key = table->slots[index].key;
+	if (removed_content) *removed_content = table->slots[index].value;
+
+	//Probing never went past a group that still has an empty slot, so no tombstone is needed there
+	if (group_match(&table->ctrl[index & ~(size_t)(OHASHTABLE_GROUP - 1)], CTRL_EMPTY))
+	{
+		table->ctrl[index] = CTRL_EMPTY;
+		table->growth_left++;
+	}
+	else
+		table->ctrl[index] = CTRL_DELETED;
+
+	--table->count;
+	return SUS_SUCCESS;
+}
+
+size_t ohashtable_get_count(ohashtable_t *table)
+{
+	if (!table)
+		return 0;
+
+	return table->count;
+}
+
+int ohashtable_has_key(ohashtable_t *table, void* key)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	size_t index = ohashtable_find(table, key, (size_t)hash_fmix64(table->hasher(key)));
+
+	return index != table->capacity ? SUS_TRUE : SUS_FALSE;
+}
+
+vector_t *ohashtable_list_keys(ohashtable_t *table)
+{
+	if (!table) return NULL;
+
+	vector_t *ret = vector_create();
+	if (!ret) return NULL;
+
+	if (vector_ensure(ret, table->count))
+	{
+		vector_destroy(ret);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < table->capacity; i++)
+		if (CTRL_IS_FULL(table->ctrl[i]))
+			vector_append(ret, table->slots[i].key);
+
+	return ret;
+}
+
+vector_t *ohashtable_list_contents(ohashtable_t *table)
+{
+	if (!table) return NULL;
+
+	vector_t *ret = vector_create();
+	if (!ret) return NULL;
+
+	if (vector_ensure(ret, table->count))
+	{
+		vector_destroy(ret);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < table->capacity; i++)
+		if (CTRL_IS_FULL(table->ctrl[i]))
+			vector_append(ret, table->slots[i].value);
+
+	return ret;
+}
+
+int ohashtable_resize(ohashtable_t *table, size_t capacity)
+{
+	if (!table) return SUS_INVALID_ARG;
+
+	size_t target = round_pow2(capacity, OHASHTABLE_GROUP);
+	if (!target || target > SIZE_MAX / sizeof(ohashtable_slot_t)) return SUS_FAILED_ALLOC;
+
+	if (table->count > OHASHTABLE_MAX_FILL(target))
+		return SUS_INVALID_ARG;
+
+	if (table->capacity == target)
+		return SUS_SUCCESS;
+
+	return ohashtable_rehash(table, target);
+}
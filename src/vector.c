@@ -5,6 +5,11 @@
 #include <stdlib.h>
 
 #include "sus.h"
+#include "math_utils.h"
+#include "ivector.h"
+#include "workers.h"
+#include "mapped.h"
+#include "parallel.h"
 
 
 
@@ -18,15 +23,116 @@ vector_t *vector_create()
 
 	ret->count = 0;
 	ret->capacity = VECTOR_DEFAULT_CAP;
+	ret->flags = 0;
 
 	return ret;
 }
 
+//Frees the storage in whichever way it was obtained, borrowed storage is left alone
+static void vector_release(vector_t *vec)
+{
+	if (vec->flags & VECTOR_FLAG_MAPPED)
+		mapped_free(vec->data, vec->capacity * sizeof(void *));
+	else if (!(vec->flags & VECTOR_FLAG_BORROWED))
+		free(vec->data);
+}
+
+//Moves the elements into storage for capacity elements, mapped once it reaches VECTOR_MAP_MIN bytes
+//Mapped storage fills its last page, so capacity may come out larger
+static int vector_resize(vector_t *vec, size_t capacity)
+{
+	size_t bytes = capacity * sizeof(void *), old_bytes = vec->capacity * sizeof(void *);
+	int huge = vec->flags & VECTOR_FLAG_HUGE_PAGES;
+	int mapped = bytes >= VECTOR_MAP_MIN;
+	void **tmp = NULL;
+
+	if (!capacity)
+	{
+		vector_release(vec);
+	}
+	else if (mapped && (vec->flags & VECTOR_FLAG_MAPPED))
+	{
+		tmp = mapped_realloc(vec->data, old_bytes, bytes, huge);
+		if (!tmp) return SUS_FAILED_ALLOC;
+	}
+	else if (!mapped && !(vec->flags & (VECTOR_FLAG_MAPPED | VECTOR_FLAG_BORROWED)))
+	{
+		tmp = realloc(vec->data, bytes);
+		if (!tmp) return SUS_FAILED_ALLOC;
+	}
+	else
+	{
+		//Switching kinds of storage, the elements are copied once and the old storage released
+		tmp = mapped ? mapped_alloc(bytes, huge) : malloc(bytes);
+		if (!tmp) return SUS_FAILED_ALLOC;
+
+		memcpy(tmp, vec->data, MIN(vec->count, capacity) * sizeof(void *));
+		vector_release(vec);
+	}
+
+	vec->data = tmp;
+	vec->capacity = mapped ? mapped_capacity(capacity, sizeof(void *)) : capacity;
+	vec->flags &= ~(VECTOR_FLAG_MAPPED | VECTOR_FLAG_BORROWED);
+	if (mapped) vec->flags |= VECTOR_FLAG_MAPPED;
+
+	return SUS_SUCCESS;
+}
+
+//Smallest capacity the growth policy reaches that holds at least target elements
+static size_t vector_grow(vector_t *vec, size_t target)
+{
+	size_t capacity = MAX(vec->capacity, VECTOR_DEFAULT_CAP);
+	size_t step = MAX(VECTOR_GROW_STEP / sizeof(void *), 1);
+
+	while (capacity < target)
+	{
+		if ((vec->flags & VECTOR_FLAG_GROW_STEP) && capacity >= step)
+			capacity = MAX(capacity + step, DIV_CEIL(target, step) * step);
+		else if (vec->flags & VECTOR_FLAG_GROW_HALF)
+			capacity += capacity / 2;
+		else
+			capacity <<= 1;
+	}
+
+	return capacity;
+}
+
+int vector_init(vector_t *vec)
+{
+	return vector_init_buffer(vec, NULL, 0);
+}
+
+int vector_init_buffer(vector_t *vec, void **buf, size_t capacity)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!buf && capacity) return SUS_INVALID_ARG;
+
+	vec->data = buf;
+	vec->capacity = capacity;
+	vec->count = 0;
+	vec->flags = buf ? VECTOR_FLAG_BORROWED : 0;
+
+	return SUS_SUCCESS;
+}
+
+int vector_deinit(vector_t *vec)
+{
+	if (!vec) return SUS_INVALID_ARG;
+
+	int growth = vec->flags & VECTOR_GROWTH_FLAGS;
+
+	vector_release(vec);
+	vector_init(vec);
+	vec->flags = growth;
+
+	return SUS_SUCCESS;
+}
+
 int vector_destroy(vector_t *vec)
 {
 	if (!vec) return SUS_INVALID_ARG;
 
-	free(vec->data);
+	vector_release(vec);
 	free(vec);
 
 	return SUS_SUCCESS;
@@ -50,6 +156,7 @@ vector_t *vector_duplicate(vector_t *vec)
 	if (!ret)
 		return NULL;
 
+	ret->flags = vec->flags & VECTOR_GROWTH_FLAGS;
 	if (vector_ensure(ret, vec->count))
 	{
 		vector_destroy(ret);
@@ -84,32 +191,25 @@ int vector_ensure(vector_t *vec, size_t capacity)
 {
 	if (!vec) return SUS_INVALID_ARG;
 	if (vec->capacity >= capacity) return SUS_SUCCESS;
-	size_t old_capacity = vec->capacity;
-
-	if (vec->capacity < VECTOR_DEFAULT_CAP) vec->capacity = VECTOR_DEFAULT_CAP;
-	while (vec->capacity < capacity) vec->capacity <<= 1;
-
-	void **tmp = realloc(vec->data, vec->capacity * sizeof(void *));
-	if (!tmp) 
-	{
-		vec->capacity = old_capacity;
-		return SUS_FAILED_ALLOC;
-	}
 
-	vec->data = tmp;
-	return SUS_SUCCESS;
+	return vector_resize(vec, vector_grow(vec, capacity));
 }
 
 int vector_trim(vector_t *vec)
 {
 	if (!vec) return SUS_INVALID_ARG;
 	if (vec->count == vec->capacity) return SUS_SUCCESS;
+	if (vec->flags & VECTOR_FLAG_BORROWED) return SUS_SUCCESS;
 
-	void **tmp = realloc(vec->data, vec->count * sizeof(void *));
-	if (!tmp) return SUS_FAILED_ALLOC;
+	return vector_resize(vec, vec->count);
+}
 
-	vec->data = tmp;
-	vec->capacity = vec->count;
+int vector_set_growth(vector_t *vec, int flags)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (flags & ~VECTOR_GROWTH_FLAGS) return SUS_INVALID_ARG;
+
+	vec->flags = (vec->flags & ~VECTOR_GROWTH_FLAGS) | flags;
 	return SUS_SUCCESS;
 }
 
@@ -222,6 +322,68 @@ int vector_remove_range(vector_t *vec, size_t start, size_t count)
 	return SUS_SUCCESS;
 }
 
+int vector_insert_range_at(vector_t *vec, vector_t *src, size_t start, size_t count, size_t index)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!src) return SUS_INVALID_ARG;
+	if (start > src->count || count > src->count - start) return SUS_INVALID_RANGE;
+	if (index > vec->count) return SUS_INVALID_INDEX;
+
+	int err = vector_ensure(vec, vec->count + count);
+	if (err) return err;
+
+	memmove(&vec->data[index + count], &vec->data[index], (vec->count - index) * sizeof(void *));
+
+	//Inserting a vector into itself, the part of the range at or past index was just shifted by count
+	if (src == vec && start + count > index)
+	{
+		size_t before = start < index ? index - start : 0;
+		memcpy(&vec->data[index], &vec->data[start], before * sizeof(void *));
+		memcpy(&vec->data[index + before], &vec->data[start + before + count], (count - before) * sizeof(void *));
+	}
+	else
+	{
+		memcpy(&vec->data[index], &src->data[start], count * sizeof(void *));
+	}
+
+	vec->count += count;
+	return SUS_SUCCESS;
+}
+
+int vector_insert_vector_at(vector_t *vec, vector_t *src, size_t index)
+{
+	if (!src) return SUS_INVALID_ARG;
+
+	return vector_insert_range_at(vec, src, 0, src->count, index);
+}
+
+int vector_remove_indices(vector_t *vec, const size_t *indices, size_t count)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!count) return SUS_SUCCESS;
+	if (!indices) return SUS_INVALID_ARG;
+
+	//Checked up front so a bad list leaves the vector untouched
+	for (size_t i = 0; i < count; i++)
+	{
+		if (indices[i] >= vec->count) return SUS_INVALID_INDEX;
+		if (i && indices[i] <= indices[i - 1]) return SUS_INVALID_ARG;
+	}
+
+	//Each run of kept elements between two removed indices moves once
+	size_t write = indices[0];
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t run = indices[i] + 1, end = i + 1 < count ? indices[i + 1] : vec->count;
+		memmove(&vec->data[write], &vec->data[run], (end - run) * sizeof(void *));
+		write += end - run;
+	}
+
+	vec->count = write;
+	return SUS_SUCCESS;
+}
+
 int vector_clear(vector_t *vec)
 {
 	if (!vec) return SUS_INVALID_ARG;
@@ -247,29 +409,48 @@ vector_t *vector_get_all(vector_t *vec, int (*match)(void *, void *), void *arg)
 	if (!match) return NULL;
 
 	vector_t *ret = vector_create();
+	if (!ret) return NULL;
 
-	for (size_t i = 0; i < vec->count; i++)
-		if (match(vec->data[i], arg))
-			vector_append(ret, vec->data[i]);
+	if (vector_get_all_into(vec, match, arg, ret))
+	{
+		vector_destroy(ret);
+		return NULL;
+	}
 
 	return ret;
 }
 
-size_t vector_remove(vector_t *vec, void *data)
+int vector_get_all_into(vector_t *vec, int (*match)(void *, void *), void *arg, vector_t *out)
 {
 	if (!vec) return SUS_INVALID_ARG;
+	if (!match) return SUS_INVALID_ARG;
+	if (!out) return SUS_INVALID_ARG;
 
-	size_t counter = 0;
-
-	for (size_t i = vec->count - 1; i < ~(size_t)0; i--)
+	for (size_t i = 0; i < vec->count; i++)
 	{
-		if (vec->data[i] == data)
-		{
-			vector_remove_at(vec, i);
-			counter++;
-		}
+		if (!match(vec->data[i], arg)) continue;
+
+		int err = vector_append(out, vec->data[i]);
+		if (err) return err;
 	}
 
+	return SUS_SUCCESS;
+}
+
+size_t vector_remove(vector_t *vec, void *data)
+{
+	if (!vec) return SUS_INVALID_ARG;
+
+	//Single pass, every kept element after the first match moves once
+	size_t kept = 0;
+
+	for (size_t i = 0; i < vec->count; i++)
+		if (vec->data[i] != data)
+			vec->data[kept++] = vec->data[i];
+
+	size_t counter = vec->count - kept;
+	vec->count = kept;
+
 	return counter;
 }
 
@@ -278,18 +459,317 @@ size_t vector_remove_all(vector_t *vec, int (*match)(void *, void *), void *arg)
 	if (!vec) return SUS_INVALID_ARG;
 	if (!match) return SUS_INVALID_ARG;
 
-	size_t counter = 0;
+	size_t kept = 0;
+
+	for (size_t i = 0; i < vec->count; i++)
+		if (!match(vec->data[i], arg))
+			vec->data[kept++] = vec->data[i];
+
+	size_t counter = vec->count - kept;
+	vec->count = kept;
+
+	return counter;
+}
+
+//Introsort: quicksort on median pivots, heapsort once too deep, insertion sort on small ranges
+#define VECTOR_SORT_INSERTION 16
+//Moves a partial insertion sort may make before giving up on a range that looked sorted
+#define VECTOR_SORT_PARTIAL_LIMIT 8
+
+typedef struct
+{
+	void **data;
+	void **buf;
+	void **src;
+	void **dst;
+	size_t count;
+	size_t chunks;
+	size_t width;
+	int (*comparer)(void *, void *);
+	int stable;
+} vector_sort_job_t;
+
+static inline void vector_swap(void **a, void **b)
+{
+	void *tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+static inline void vector_sort3(void **a, void **b, void **c, int (*comparer)(void *, void *))
+{
+	if (comparer(*b, *a) < 0) vector_swap(a, b);
+	if (comparer(*c, *b) < 0)
+	{
+		vector_swap(b, c);
+		if (comparer(*b, *a) < 0) vector_swap(a, b);
+	}
+}
+
+static void vector_insertion_sort(void **data, size_t count, int (*comparer)(void *, void *))
+{
+	for (size_t i = 1; i < count; i++)
+	{
+		void *tmp = data[i];
+		size_t j = i;
+
+		for (; j > 0 && comparer(data[j - 1], tmp) > 0; j--)
+			data[j] = data[j - 1];
+
+		data[j] = tmp;
+	}
+}
+
+//Returns SUS_TRUE if the range got sorted without exceeding VECTOR_SORT_PARTIAL_LIMIT moves
+static int vector_partial_insertion_sort(void **data, size_t count, int (*comparer)(void *, void *))
+{
+	size_t moves = 0;
+
+	for (size_t i = 1; i < count; i++)
+	{
+		if (comparer(data[i - 1], data[i]) <= 0) continue;
+
+		void *tmp = data[i];
+		size_t j = i;
+
+		do
+		{
+			data[j] = data[j - 1];
+			j--;
+		} while (j > 0 && comparer(data[j - 1], tmp) > 0);
+
+		data[j] = tmp;
+		moves += i - j;
+		if (moves > VECTOR_SORT_PARTIAL_LIMIT) return SUS_FALSE;
+	}
+
+	return SUS_TRUE;
+}
+
+static void vector_sift_down(void **data, size_t root, size_t count, int (*comparer)(void *, void *))
+{
+	void *tmp = data[root];
+
+	for (;;)
+	{
+		size_t child = 2 * root + 1;
+		if (child >= count) break;
+		if (child + 1 < count && comparer(data[child], data[child + 1]) < 0) child++;
+		if (comparer(tmp, data[child]) >= 0) break;
+
+		data[root] = data[child];
+		root = child;
+	}
+
+	data[root] = tmp;
+}
+
+static void vector_heap_sort(void **data, size_t count, int (*comparer)(void *, void *))
+{
+	for (size_t i = count / 2; i-- > 0;)
+		vector_sift_down(data, i, count, comparer);
 
-	for (size_t i = vec->count - 1; i < ~(size_t)0; i--)
+	for (size_t end = count - 1; end > 0; end--)
 	{
-		if (match(vec->data[i], arg))
+		vector_swap(&data[0], &data[end]);
+		vector_sift_down(data, 0, end, comparer);
+	}
+}
+
+static void vector_introsort(void **data, size_t count, int (*comparer)(void *, void *), size_t depth)
+{
+	while (count > VECTOR_SORT_INSERTION)
+	{
+		if (!depth--)
 		{
-			vector_remove_at(vec, i);
-			counter++;
+			vector_heap_sort(data, count, comparer);
+			return;
+		}
+
+		//Median of three, or pseudo median of nine on larger ranges, moved to the front as pivot
+		size_t mid = count / 2;
+		vector_sort3(&data[0], &data[mid], &data[count - 1], comparer);
+		if (count > 128)
+		{
+			vector_sort3(&data[1], &data[mid - 1], &data[count - 2], comparer);
+			vector_sort3(&data[2], &data[mid + 1], &data[count - 3], comparer);
+			vector_sort3(&data[mid - 1], &data[mid], &data[mid + 1], comparer);
+		}
+		vector_swap(&data[0], &data[mid]);
+
+		//Hoare partition, both sides stop on elements equal to the pivot so duplicates split evenly
+		void *pivot = data[0];
+		size_t i = 0, j = count;
+		int swapped = 0;
+
+		for (;;)
+		{
+			do i++; while (i < count && comparer(data[i], pivot) < 0);
+			do j--; while (comparer(pivot, data[j]) < 0);
+			if (i >= j) break;
+
+			vector_swap(&data[i], &data[j]);
+			swapped = 1;
+		}
+
+		vector_swap(&data[0], &data[j]);
+
+		size_t left = j, right = count - j - 1;
+
+		//Nothing moved and the split is balanced, the input is likely (almost) sorted already
+		if (!swapped && MIN(left, right) >= count / 8
+			&& vector_partial_insertion_sort(data, left, comparer)
+			&& vector_partial_insertion_sort(&data[j + 1], right, comparer))
+			return;
+
+		//Recurse into the smaller side, loop on the larger one, keeps the stack logarithmic
+		if (left < right)
+		{
+			vector_introsort(data, left, comparer, depth);
+			data += j + 1;
+			count = right;
+		}
+		else
+		{
+			vector_introsort(&data[j + 1], right, comparer, depth);
+			count = left;
 		}
 	}
 
-	return counter;
+	vector_insertion_sort(data, count, comparer);
+}
+
+static void vector_unstable_sort(void **data, size_t count, int (*comparer)(void *, void *))
+{
+	size_t depth = 0;
+	for (size_t n = count; n > 1; n >>= 1)
+		depth += 2;
+
+	vector_introsort(data, count, comparer, depth);
+}
+
+//Equal elements take from a first, so merging keeps order
+static void vector_merge(void **dst, void **a, size_t a_count, void **b, size_t b_count, int (*comparer)(void *, void *))
+{
+	while (a_count && b_count)
+	{
+		if (comparer(*b, *a) < 0) { *dst++ = *b++; b_count--; }
+		else { *dst++ = *a++; a_count--; }
+	}
+
+	memcpy(dst, a, a_count * sizeof(void *));
+	memcpy(dst + a_count, b, b_count * sizeof(void *));
+}
+
+//Bottom up merge sort over insertion sorted runs, buf must hold count pointers
+static void vector_merge_sort(void **data, void **buf, size_t count, int (*comparer)(void *, void *))
+{
+	for (size_t i = 0; i < count; i += VECTOR_SORT_INSERTION)
+		vector_insertion_sort(&data[i], MIN(VECTOR_SORT_INSERTION, count - i), comparer);
+
+	void **src = data, **dst = buf;
+
+	for (size_t width = VECTOR_SORT_INSERTION; width < count; width <<= 1)
+	{
+		for (size_t i = 0; i < count; i += 2 * width)
+		{
+			size_t mid = MIN(i + width, count), end = MIN(i + 2 * width, count);
+
+			//Runs already in order are copied as is, makes sorted input linear
+			if (mid == end || comparer(src[mid - 1], src[mid]) <= 0)
+				memcpy(&dst[i], &src[i], (end - i) * sizeof(void *));
+			else
+				vector_merge(&dst[i], &src[i], mid - i, &src[mid], end - mid, comparer);
+		}
+
+		void **tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != data)
+		memcpy(data, src, count * sizeof(void *));
+}
+
+//Number of elements from a among the first k of merge(a, b)
+static size_t vector_merge_split(size_t k, void **a, size_t a_count, void **b, size_t b_count, int (*comparer)(void *, void *))
+{
+	size_t lo = k > b_count ? k - b_count : 0, hi = MIN(k, a_count);
+
+	while (lo < hi)
+	{
+		size_t i = lo + (hi - lo) / 2, j = k - i;
+
+		if (j > 0 && i < a_count && comparer(a[i], b[j - 1]) <= 0) lo = i + 1;
+		else hi = i;
+	}
+
+	return lo;
+}
+
+static inline size_t vector_chunk_start(vector_sort_job_t *job, size_t chunk)
+{
+	return job->count * MIN(chunk, job->chunks) / job->chunks;
+}
+
+static void vector_sort_chunk(void *arg, size_t chunk)
+{
+	vector_sort_job_t *job = arg;
+	size_t start = vector_chunk_start(job, chunk), end = vector_chunk_start(job, chunk + 1);
+
+	if (job->stable) vector_merge_sort(&job->data[start], &job->buf[start], end - start, job->comparer);
+	else vector_unstable_sort(&job->data[start], end - start, job->comparer);
+}
+
+//Each worker produces the output of one chunk, which lies inside a single pair of runs being merged
+static void vector_merge_chunk(void *arg, size_t chunk)
+{
+	vector_sort_job_t *job = arg;
+	size_t first = chunk / (2 * job->width) * 2 * job->width;
+	size_t start = vector_chunk_start(job, first);
+	size_t mid = vector_chunk_start(job, first + job->width);
+	size_t end = vector_chunk_start(job, first + 2 * job->width);
+	size_t k0 = vector_chunk_start(job, chunk) - start, k1 = vector_chunk_start(job, chunk + 1) - start;
+
+	void **a = &job->src[start], **b = &job->src[mid];
+	size_t i0 = vector_merge_split(k0, a, mid - start, b, end - mid, job->comparer);
+	size_t i1 = vector_merge_split(k1, a, mid - start, b, end - mid, job->comparer);
+
+	vector_merge(&job->dst[start + k0], &a[i0], i1 - i0, &b[k0 - i0], (k1 - i1) - (k0 - i0), job->comparer);
+}
+
+//Sorts one chunk per CPU, then merges pairs of runs with every CPU busy on every round
+static int vector_parallel_sort(void **data, size_t count, int (*comparer)(void *, void *), int stable)
+{
+	vector_sort_job_t job;
+	job.buf = malloc(count * sizeof(void *));
+	if (!job.buf) return SUS_FAILED_ALLOC;
+
+	job.data = data;
+	job.count = count;
+	job.chunks = workers_count();
+	job.comparer = comparer;
+	job.stable = stable;
+
+	workers_run(job.chunks, vector_sort_chunk, &job);
+
+	job.src = data;
+	job.dst = job.buf;
+
+	for (job.width = 1; job.width < job.chunks; job.width <<= 1)
+	{
+		workers_run(job.chunks, vector_merge_chunk, &job);
+
+		void **tmp = job.src;
+		job.src = job.dst;
+		job.dst = tmp;
+	}
+
+	if (job.src != data)
+		memcpy(data, job.src, count * sizeof(void *));
+
+	free(job.buf);
+	return SUS_SUCCESS;
 }
 
 vector_t *vector_sort(vector_t *vec, int (*comparer)(void *, void *))
@@ -297,19 +777,484 @@ vector_t *vector_sort(vector_t *vec, int (*comparer)(void *, void *))
 	if (!vec) return NULL;
 	if (!comparer) return NULL;
 
-	for (size_t gap = vec->count / 2; gap > 0; gap >>= 1)
+	if (vec->count >= VECTOR_SORT_PARALLEL_MIN && workers_count() > 1
+		&& vector_parallel_sort(vec->data, vec->count, comparer, 0) == SUS_SUCCESS)
+		return vec;
+
+	vector_unstable_sort(vec->data, vec->count, comparer);
+
+	return vec;
+}
+
+vector_t *vector_sort_stable(vector_t *vec, int (*comparer)(void *, void *))
+{
+	if (!vec) return NULL;
+	if (!comparer) return NULL;
+
+	if (vec->count <= VECTOR_SORT_INSERTION)
 	{
-		for (size_t i = gap; i < vec->count; i++)
-		{
-			void *tmp = vec->data[i];
+		vector_insertion_sort(vec->data, vec->count, comparer);
+		return vec;
+	}
+
+	if (vec->count >= VECTOR_SORT_PARALLEL_MIN && workers_count() > 1)
+		return vector_parallel_sort(vec->data, vec->count, comparer, 1) ? NULL : vec;
+
+	void **buf = malloc(vec->count * sizeof(void *));
+	if (!buf) return NULL;
+
+	vector_merge_sort(vec->data, buf, vec->count, comparer);
+	free(buf);
+
+	return vec;
+}
+
+typedef struct
+{
+	void **data;
+	size_t count;
+	size_t grain;
+	void *arg;
+	void (*func)(void *, void *);
+	int (*match)(void *, void *);
+	void (*map)(void *, void *, void *);
+	void (*fold)(void *, void *, void *);
+	unsigned char *matched;
+	size_t *offsets;
+	void **out;
+	char *mapped;
+	size_t mapped_size;
+	char *accs;
+	size_t acc_size;
+	void *identity;
+} vector_parallel_job_t;
+
+//Fills the fields every parallel job uses, returns the number of chunks
+static size_t vector_parallel_setup(vector_parallel_job_t *job, vector_t *vec, void *arg, size_t grain)
+{
+	job->data = vec->data;
+	job->count = vec->count;
+	job->grain = grain ? grain : PARALLEL_DEFAULT_GRAIN;
+	job->arg = arg;
+
+	return DIV_CEIL(job->count, job->grain);
+}
+
+static void vector_parallel_iterate_chunk(void *arg, size_t chunk)
+{
+	vector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count);
+
+	for (size_t i = start; i < end; i++)
+		job->func(job->data[i], job->arg);
+}
+
+int vector_parallel_iterate(vector_t *vec, void (*func)(void *, void *), void *arg, size_t grain)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!func) return SUS_INVALID_ARG;
+
+	vector_parallel_job_t job;
+	size_t chunks = vector_parallel_setup(&job, vec, arg, grain);
+	job.func = func;
+
+	workers_run(chunks, vector_parallel_iterate_chunk, &job);
+
+	return SUS_SUCCESS;
+}
+
+//First pass of the filter, every chunk records which of its elements matched and how many did
+static void vector_parallel_match_chunk(void *arg, size_t chunk)
+{
+	vector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count), matches = 0;
+
+	for (size_t i = start; i < end; i++)
+		matches += job->matched[i] = job->match(job->data[i], job->arg) ? 1 : 0;
+
+	job->offsets[chunk] = matches;
+}
+
+//Second pass, offsets now hold where each chunk starts writing so the matches keep their order
+static void vector_parallel_gather_chunk(void *arg, size_t chunk)
+{
+	vector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count), write = job->offsets[chunk];
 
-			size_t j;
-			for (j = i; j >= gap && comparer(vec->data[j - gap], tmp) > 0; j -= gap)
-				vec->data[j] = vec->data[j - gap];
+	for (size_t i = start; i < end; i++)
+		if (job->matched[i])
+			job->out[write++] = job->data[i];
+}
+
+int vector_parallel_filter(vector_t *vec, int (*match)(void *, void *), void *arg, vector_t *out, size_t grain)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!match) return SUS_INVALID_ARG;
+	if (!out || out == vec) return SUS_INVALID_ARG;
+
+	vector_parallel_job_t job;
+	size_t chunks = vector_parallel_setup(&job, vec, arg, grain);
+	job.match = match;
+
+	if (chunks <= 1) return vector_get_all_into(vec, match, arg, out);
+
+	job.matched = malloc(job.count);
+	job.offsets = malloc(chunks * sizeof(size_t));
+	if (!job.matched || !job.offsets)
+	{
+		free(job.matched);
+		free(job.offsets);
+		return SUS_FAILED_ALLOC;
+	}
+
+	workers_run(chunks, vector_parallel_match_chunk, &job);
+
+	size_t total = 0;
+	for (size_t i = 0; i < chunks; i++)
+	{
+		size_t matches = job.offsets[i];
+		job.offsets[i] = total;
+		total += matches;
+	}
+
+	int err = vector_ensure(out, out->count + total);
+	if (!err)
+	{
+		job.out = &out->data[out->count];
+		workers_run(chunks, vector_parallel_gather_chunk, &job);
+		out->count += total;
+	}
+
+	free(job.matched);
+	free(job.offsets);
+	return err;
+}
+
+static void vector_parallel_map_chunk(void *arg, size_t chunk)
+{
+	vector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count);
+
+	for (size_t i = start; i < end; i++)
+		job->map(job->data[i], job->mapped + i * job->mapped_size, job->arg);
+}
+
+int vector_parallel_map(vector_t *vec, void (*func)(void *, void *, void *), void *arg, ivector_t *out, size_t grain)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!func) return SUS_INVALID_ARG;
+	if (!out) return SUS_INVALID_ARG;
+
+	int err = ivector_ensure(out, out->count + vec->count);
+	if (err) return err;
+
+	vector_parallel_job_t job;
+	size_t chunks = vector_parallel_setup(&job, vec, arg, grain);
+	job.map = func;
+	job.mapped = (char *)out->data + out->count * out->element_size;
+	job.mapped_size = out->element_size;
+
+	workers_run(chunks, vector_parallel_map_chunk, &job);
+	out->count += vec->count;
+
+	return SUS_SUCCESS;
+}
+
+static void vector_parallel_fold_chunk(void *arg, size_t chunk)
+{
+	vector_parallel_job_t *job = arg;
+	size_t start = chunk * job->grain, end = MIN(start + job->grain, job->count);
+	char *acc = job->accs + chunk * job->acc_size;
+
+	memcpy(acc, job->identity, job->acc_size);
+	for (size_t i = start; i < end; i++)
+		job->fold(acc, job->data[i], job->arg);
+}
+
+int vector_parallel_reduce(vector_t *vec, void (*fold)(void *, void *, void *), void (*combine)(void *, void *, void *), void *acc, size_t acc_size, void *arg, size_t grain)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!fold || !combine) return SUS_INVALID_ARG;
+	if (!acc) return SUS_INVALID_ARG;
+
+	vector_parallel_job_t job;
+	size_t chunks = vector_parallel_setup(&job, vec, arg, grain);
+	job.fold = fold;
+
+	if (chunks <= 1)
+	{
+		for (size_t i = 0; i < job.count; i++)
+			fold(acc, job.data[i], arg);
+		return SUS_SUCCESS;
+	}
+
+	job.accs = malloc(chunks * acc_size);
+	if (!job.accs) return SUS_FAILED_ALLOC;
+	job.acc_size = acc_size;
+	job.identity = acc;
+
+	workers_run(chunks, vector_parallel_fold_chunk, &job);
+
+	//Combined in chunk order, so combine only has to be associative
+	for (size_t i = 0; i < chunks; i++)
+		combine(acc, job.accs + i * acc_size, arg);
+
+	free(job.accs);
+	return SUS_SUCCESS;
+}
+
+//Sorted vectors, comparer(elem, key) must order elements the same way the vector was sorted
+
+#define VECTOR_SET_UNION 0
+#define VECTOR_SET_INTERSECT 1
+#define VECTOR_SET_DIFFERENCE 2
+
+//Halves the range without branching on the comparison, the step compiles to a conditional move
+//upper of 0 finds the first element not below key, 1 the first element above it
+static size_t vector_bound(void **data, size_t count, void *key, int (*comparer)(void *, void *), int upper)
+{
+	if (!count) return 0;
 
-			vec->data[j] = tmp;
+	void **base = data;
+
+	while (count > 1)
+	{
+		size_t half = count / 2;
+		base = comparer(base[half], key) < upper ? base + half : base;
+		count -= half;
+	}
+
+	return base - data + (comparer(*base, key) < upper);
+}
+
+size_t vector_lower_bound(vector_t *vec, void *key, int (*comparer)(void *, void *))
+{
+	if (!vec) return 0;
+	if (!comparer) return 0;
+
+	return vector_bound(vec->data, vec->count, key, comparer, 0);
+}
+
+size_t vector_upper_bound(vector_t *vec, void *key, int (*comparer)(void *, void *))
+{
+	if (!vec) return 0;
+	if (!comparer) return 0;
+
+	return vector_bound(vec->data, vec->count, key, comparer, 1);
+}
+
+int vector_binary_search(vector_t *vec, void *key, int (*comparer)(void *, void *), size_t *index)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+
+	size_t i = vector_bound(vec->data, vec->count, key, comparer, 0);
+	if (index) *index = i;
+
+	return i < vec->count && !comparer(vec->data[i], key) ? SUS_TRUE : SUS_FALSE;
+}
+
+int vector_insert_sorted(vector_t *vec, void *data, int (*comparer)(void *, void *))
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+
+	int err = vector_ensure(vec, vec->count + 1);
+	if (err) return err;
+
+	return vector_insert_at(vec, data, vector_bound(vec->data, vec->count, data, comparer, 1));
+}
+
+int vector_insert_sorted_unique(vector_t *vec, void *data, int (*comparer)(void *, void *), int *inserted)
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+
+	size_t i = vector_bound(vec->data, vec->count, data, comparer, 0);
+
+	if (i < vec->count && !comparer(vec->data[i], data))
+	{
+		if (inserted) *inserted = SUS_FALSE;
+		return SUS_SUCCESS;
+	}
+
+	int err = vector_ensure(vec, vec->count + 1);
+	if (err) return err;
+
+	if (inserted) *inserted = SUS_TRUE;
+	return vector_insert_at(vec, data, i);
+}
+
+size_t vector_unique(vector_t *vec, int (*comparer)(void *, void *))
+{
+	if (!vec) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+	if (vec->count < 2) return 0;
+
+	size_t kept = 1;
+
+	for (size_t i = 1; i < vec->count; i++)
+		if (comparer(vec->data[kept - 1], vec->data[i]))
+			vec->data[kept++] = vec->data[i];
+
+	size_t counter = vec->count - kept;
+	vec->count = kept;
+
+	return counter;
+}
+
+//Single merge pass shared by the set operations, out is grown once up front
+static int vector_set_op(vector_t *a, vector_t *b, int (*comparer)(void *, void *), vector_t *out, int op)
+{
+	if (!a || !b) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+	if (!out || out == a || out == b) return SUS_INVALID_ARG;
+
+	size_t most = op == VECTOR_SET_UNION ? a->count + b->count : (op == VECTOR_SET_INTERSECT ? MIN(a->count, b->count) : a->count);
+	int err = vector_ensure(out, out->count + most);
+	if (err) return err;
+
+	void **dst = &out->data[out->count];
+	size_t i = 0, j = 0, write = 0;
+
+	while (i < a->count && j < b->count)
+	{
+		int cmp = comparer(a->data[i], b->data[j]);
+
+		if (cmp < 0)
+		{
+			if (op != VECTOR_SET_INTERSECT) dst[write++] = a->data[i];
+			i++;
+		}
+		else if (cmp > 0)
+		{
+			if (op == VECTOR_SET_UNION) dst[write++] = b->data[j];
+			j++;
+		}
+		else
+		{
+			if (op != VECTOR_SET_DIFFERENCE) dst[write++] = a->data[i];
+			i++;
+			j++;
 		}
 	}
 
-	return vec;
+	if (op != VECTOR_SET_INTERSECT)
+	{
+		memcpy(&dst[write], &a->data[i], (a->count - i) * sizeof(void *));
+		write += a->count - i;
+	}
+
+	if (op == VECTOR_SET_UNION)
+	{
+		memcpy(&dst[write], &b->data[j], (b->count - j) * sizeof(void *));
+		write += b->count - j;
+	}
+
+	out->count += write;
+	return SUS_SUCCESS;
+}
+
+int vector_set_union(vector_t *a, vector_t *b, int (*comparer)(void *, void *), vector_t *out)
+{
+	return vector_set_op(a, b, comparer, out, VECTOR_SET_UNION);
+}
+
+int vector_set_intersect(vector_t *a, vector_t *b, int (*comparer)(void *, void *), vector_t *out)
+{
+	return vector_set_op(a, b, comparer, out, VECTOR_SET_INTERSECT);
+}
+
+int vector_set_difference(vector_t *a, vector_t *b, int (*comparer)(void *, void *), vector_t *out)
+{
+	return vector_set_op(a, b, comparer, out, VECTOR_SET_DIFFERENCE);
+}
+
+typedef struct
+{
+	vector_t **srcs;
+	size_t *pos;
+	size_t *heap;
+	size_t size;
+	int (*comparer)(void *, void *);
+} vector_kmerge_t;
+
+//Ties go to the lower source so the merge is stable
+static inline int vector_kmerge_less(vector_kmerge_t *merge, size_t x, size_t y)
+{
+	int cmp = merge->comparer(merge->srcs[x]->data[merge->pos[x]], merge->srcs[y]->data[merge->pos[y]]);
+	return cmp < 0 || (!cmp && x < y);
+}
+
+static void vector_kmerge_sift_down(vector_kmerge_t *merge, size_t root)
+{
+	size_t *heap = merge->heap, tmp = heap[root];
+
+	for (;;)
+	{
+		size_t child = 2 * root + 1;
+		if (child >= merge->size) break;
+		if (child + 1 < merge->size && vector_kmerge_less(merge, heap[child + 1], heap[child])) child++;
+		if (!vector_kmerge_less(merge, heap[child], tmp)) break;
+
+		heap[root] = heap[child];
+		root = child;
+	}
+
+	heap[root] = tmp;
+}
+
+int vector_merge_sorted(vector_t **srcs, size_t count, int (*comparer)(void *, void *), vector_t *out)
+{
+	if (!srcs && count) return SUS_INVALID_ARG;
+	if (!comparer) return SUS_INVALID_ARG;
+	if (!out) return SUS_INVALID_ARG;
+
+	size_t total = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!srcs[i] || srcs[i] == out) return SUS_INVALID_ARG;
+		total += srcs[i]->count;
+	}
+
+	int err = vector_ensure(out, out->count + total);
+	if (err) return err;
+
+	vector_kmerge_t merge;
+	merge.srcs = srcs;
+	merge.comparer = comparer;
+	merge.size = 0;
+	merge.pos = calloc(2 * count + 1, sizeof(size_t));
+	if (!merge.pos) return SUS_FAILED_ALLOC;
+	merge.heap = merge.pos + count;
+
+	for (size_t i = 0; i < count; i++)
+		if (srcs[i]->count)
+			merge.heap[merge.size++] = i;
+
+	for (size_t i = merge.size / 2; i-- > 0;)
+		vector_kmerge_sift_down(&merge, i);
+
+	void **dst = &out->data[out->count];
+
+	//The smallest head is always on top of the heap, the last source left is copied as a block
+	while (merge.size > 1)
+	{
+		size_t src = merge.heap[0];
+		*dst++ = srcs[src]->data[merge.pos[src]++];
+
+		if (merge.pos[src] == srcs[src]->count)
+			merge.heap[0] = merge.heap[--merge.size];
+		vector_kmerge_sift_down(&merge, 0);
+	}
+
+	if (merge.size)
+	{
+		size_t src = merge.heap[0];
+		memcpy(dst, &srcs[src]->data[merge.pos[src]], (srcs[src]->count - merge.pos[src]) * sizeof(void *));
+	}
+
+	out->count += total;
+	free(merge.pos);
+	return SUS_SUCCESS;
 }
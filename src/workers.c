@@ -0,0 +1,160 @@
+#include "workers.h"
+#include "parallel.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sus.h"
+#include "math_utils.h"
+
+
+
+#define WORKERS_MAX 64
+
+//The pool runs a single job at a time, threads sleep on workers_wake until its generation changes
+typedef struct
+{
+	void (*func)(void *, size_t);
+	void *arg;
+	size_t count;
+	atomic_size_t next;
+	//Pool threads allowed to join, that have joined and that are still inside the job
+	size_t wanted;
+	size_t joined;
+	size_t active;
+	unsigned long generation;
+} workers_job_t;
+
+//Guards the job slot and the started count
+static pthread_mutex_t workers_lock = PTHREAD_MUTEX_INITIALIZER;
+//Held by the caller for the whole job
+static pthread_mutex_t workers_run_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workers_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t workers_idle = PTHREAD_COND_INITIALIZER;
+static workers_job_t workers_job;
+static size_t workers_started = 0;
+static atomic_size_t workers_limit = 0;
+
+
+
+size_t workers_count(void)
+{
+	static size_t online = 0;
+
+	size_t limit = atomic_load(&workers_limit);
+	if (limit) return limit;
+
+	if (!online)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		online = cpus < 1 ? 1 : (cpus > WORKERS_MAX ? WORKERS_MAX : (size_t)cpus);
+	}
+
+	return online;
+}
+
+int parallel_set_workers(size_t count)
+{
+	atomic_store(&workers_limit, MIN(count, WORKERS_MAX));
+	return SUS_SUCCESS;
+}
+
+size_t parallel_get_workers(void)
+{
+	return workers_count();
+}
+
+static void workers_drain(void (*func)(void *, size_t), void *arg, size_t count)
+{
+	size_t i;
+
+	while ((i = atomic_fetch_add(&workers_job.next, 1)) < count)
+		func(arg, i);
+}
+
+static void *workers_entry(void *unused)
+{
+	(void)unused;
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&workers_lock);
+
+	for (;;)
+	{
+		while (workers_job.generation == seen)
+			pthread_cond_wait(&workers_wake, &workers_lock);
+
+		seen = workers_job.generation;
+		if (workers_job.joined >= workers_job.wanted) continue;
+
+		workers_job.joined++;
+		workers_job.active++;
+		void (*func)(void *, size_t) = workers_job.func;
+		void *arg = workers_job.arg;
+		size_t count = workers_job.count;
+
+		pthread_mutex_unlock(&workers_lock);
+		workers_drain(func, arg, count);
+		pthread_mutex_lock(&workers_lock);
+
+		if (!--workers_job.active)
+			pthread_cond_signal(&workers_idle);
+	}
+
+	return NULL;
+}
+
+void workers_run(size_t count, void (*func)(void *, size_t), void *arg)
+{
+	size_t helpers = MIN(workers_count(), count);
+	helpers = helpers ? helpers - 1 : 0;
+
+	//Nothing to share, or the pool is busy (possibly with the job that called us)
+	if (!helpers || pthread_mutex_trylock(&workers_run_lock))
+	{
+		for (size_t i = 0; i < count; i++)
+			func(arg, i);
+		return;
+	}
+
+	pthread_mutex_lock(&workers_lock);
+
+	//Threads are started on first use and then kept, any that cannot be started leave the work to the others
+	while (workers_started < helpers)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, workers_entry, NULL)) break;
+
+		pthread_detach(thread);
+		workers_started++;
+	}
+
+	//Threads that joined the last job late may still be leaving it
+	while (workers_job.active)
+		pthread_cond_wait(&workers_idle, &workers_lock);
+
+	workers_job.func = func;
+	workers_job.arg = arg;
+	workers_job.count = count;
+	atomic_store(&workers_job.next, 0);
+	workers_job.wanted = MIN(helpers, workers_started);
+	workers_job.joined = 0;
+	workers_job.generation++;
+
+	pthread_cond_broadcast(&workers_wake);
+	pthread_mutex_unlock(&workers_lock);
+
+	workers_drain(func, arg, count);
+
+	//Every index is claimed, wait for those still running and keep late threads out
+	pthread_mutex_lock(&workers_lock);
+	while (workers_job.active)
+		pthread_cond_wait(&workers_idle, &workers_lock);
+	workers_job.wanted = 0;
+	pthread_mutex_unlock(&workers_lock);
+
+	pthread_mutex_unlock(&workers_run_lock);
+}
@@ -0,0 +1,15 @@
+#ifndef SUS_WORKERS_H_
+#define SUS_WORKERS_H_
+
+#include <stddef.h>
+
+//Internal helpers to split work across threads, not installed
+
+//Threads a single job may use, online CPUs unless capped with parallel_set_workers, at least 1
+size_t workers_count(void);
+//Calls func(arg, i) for every i below count across the pool, returns once all are done
+//The caller takes part, indices are claimed one at a time so count may exceed the number of threads
+//Calls made while another job is running, including from inside func, run every index on the caller
+void workers_run(size_t count, void (*func)(void *, size_t), void *arg);
+
+#endif